@@ -28,7 +28,7 @@ MCoverage::Stats MCoverage::analyze(const std::vector<FileName> &files, const Op
 
                 if (x.mapped)
                 {
-                    if (r.seqsL1().count(x.cID))
+                    if (r.isSeqL1(x.cID))
                     {
                         stats.nSeqs++;
                         stats.hist.at(x.cID)++;
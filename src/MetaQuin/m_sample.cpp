@@ -1,3 +1,4 @@
+#include <mutex>
 #include "tools/errors.hpp"
 #include "MetaQuin/MetaQuin.hpp"
 #include "MetaQuin/m_sample.hpp"
@@ -24,25 +25,35 @@ MSample::Stats MSample::analyze(const FileName &file, const Options &o)
         return regs.count(x);
     };
     
-    ParserBAM::parse(file, [&](ParserBAM::Data &x, const ParserBAM::Info &info)
+    // Workers share the logger
+    std::mutex m;
+    
+    typedef MSample::Stats::SGReads SGReads;
+    
+    stats.before = ParserBAM::parallel(file, SGReads(), [&](SGReads &x, ParserBAM::Data &y, const ParserBAM::Info &info)
     {
         if (info.p.i && !(info.p.i % 1000000))
         {
+            std::lock_guard<std::mutex> lock(m);
             o.logInfo(std::to_string(info.p.i));
         }
         
         // Don't count for multiple alignments
-        if (x.isPrimary)
+        if (y.isPrimary)
         {
-            if (isMetaQuin(x.cID))
+            if (isMetaQuin(y.cID))
             {
-                stats.before.syn++;
+                x.syn++;
             }
             else
             {
-                stats.before.gen++;
+                x.gen++;
             }
         }
+    }, [&](SGReads &x, const SGReads &y)
+    {
+        x.syn += y.syn;
+        x.gen += y.gen;
     });
 
     if (stats.before.syn == 0) { throw std::runtime_error("No alignment found on the metagenome sequins"); }
@@ -53,7 +64,7 @@ MSample::Stats MSample::analyze(const FileName &file, const Options &o)
     stats.norm = o.p;
 
     // Perform subsampling
-    const auto x = Sampler::sample(file, stats.norm, o, [&](const ChrID &x) { return isMetaQuin(x); });
+    const auto x = Sampler::sample(file, SAMWriter::file(o.work + "/MetaSubsample_sampled"), stats.norm, o, [&](const ChrID &x) { return isMetaQuin(x); });
 
     stats.after = x.after;
 
@@ -74,6 +74,9 @@ static RAlign::Stats init()
         MergedInterval *mi = new MergedInterval(cID, Locus(1, std::numeric_limits<Base>::max()));
         stats.data[cID].bLvl.fp = std::shared_ptr<MergedInterval>(mi);
         
+        // One entry for each merged exon
+        stats.data[cID].e2r.resize(i.second.size());
+        
         A_CHECK(stats.data[cID].eLvl.nr(), "stats.data[cID].eLvl.nr()");
     }
 
@@ -204,18 +207,15 @@ RAlign::Stats calculate(const RAlign::Options &o, std::function<void (RAlign::St
     return stats;
 }
 
-static void match(RAlign::Stats &stats, const ParserBAM::Info &info, ParserBAM::Data &align)
+static void match(RAlign::Stats::Data &x,
+                  MergedIntervals<> &eInters,
+                  MergedIntervals<> &iInters,
+                  const ParserBAM::Info &info,
+                  ParserBAM::Data &align)
 {
     static Locus l;
     static bool spliced;
 
-    if (!stats.data.count(align.cID))
-    {
-        throw std::runtime_error("Chromsome: [" + align.cID + "] can't be found in annotations");
-    }
-    
-    auto &x = stats.data.at(align.cID);
-
     if (info.skip)
     {
         x.aLvl.spliced++;
@@ -229,7 +229,8 @@ static void match(RAlign::Stats &stats, const ParserBAM::Info &info, ParserBAM::
     // This'll be set to false whenever there is a mismatch
     bool isTP = true;
     
-    GeneID gID = "";
+    // Exon matched by the alignment
+    const MergedInterval *exon = nullptr;
 
     // Check all cigar blocks...
     while (align.nextCigar(l, spliced))
@@ -237,7 +238,7 @@ static void match(RAlign::Stats &stats, const ParserBAM::Info &info, ParserBAM::
         if (spliced)
         {
             // Can we find an exact match for the intron?
-            auto match = stats.iInters.at(align.cID).exact(l);
+            auto match = iInters.exact(l);
             
             if (match)
             {
@@ -257,7 +258,7 @@ static void match(RAlign::Stats &stats, const ParserBAM::Info &info, ParserBAM::
         else
         {
             // Can we find an contained match for the exon?
-            const auto match = stats.eInters.at(align.cID).contains(l);
+            const auto match = eInters.contains(l);
             
 #ifdef RALIGN_DEBUG
             if (ms.size() > 1)
@@ -272,14 +273,14 @@ static void match(RAlign::Stats &stats, const ParserBAM::Info &info, ParserBAM::
                 // We'll need it for calculating sensitivity at the base level
                 match->map(l);
                 
-                gID = match->gID();
+                exon = match;
 
                 writeBase(align.cID, l, "TP");
             }
             else
             {
                 // Can we find an overlapping match for the exon?
-                const auto match = stats.eInters.at(align.cID).overlap(l);
+                const auto match = eInters.overlap(l);
 
                 if (match)
                 {
@@ -323,8 +324,8 @@ static void match(RAlign::Stats &stats, const ParserBAM::Info &info, ParserBAM::
     {
         x.aLvl.m.tp()++;
 
-        A_CHECK(!gID.empty(), "!gID.empty()");
-        x.g2r[gID]++;
+        A_CHECK(exon, "exon");
+        x.e2r[exon->index()]++;
     }
     else
     {
@@ -338,6 +339,10 @@ RAlign::Stats RAlign::analyze(const FileName &file, const Options &o)
     
     return calculate(o, [&](RAlign::Stats &stats)
     {
+        auto data    = ParserBAM::index(stats.data);
+        auto eInters = ParserBAM::index(stats.eInters);
+        auto iInters = ParserBAM::index(stats.iInters);
+        
         ParserBAM::parse(file, [&](ParserBAM::Data &x, const ParserBAM::Info &info)
         {
             if (info.p.i && !(info.p.i % 1000000))
@@ -359,9 +364,16 @@ RAlign::Stats RAlign::analyze(const FileName &file, const Options &o)
             {
                 return;
             }
-            else if (isChrIS(x.cID) || stats.data.count(x.cID))
+            
+            const auto d = data.find(x);
+            
+            if (d)
+            {
+                match(*d, *eInters.find(x), *iInters.find(x), info, x);
+            }
+            else if (isChrIS(x.cID))
             {
-                match(stats, info, x);
+                throw std::runtime_error("Chromsome: [" + x.cID + "] can't be found in annotations");
             }
             else
             {
@@ -464,7 +476,7 @@ static void writeBQuins(const FileName &file,
         {
             for (const auto &k : j.second._data)
             {
-                const auto pos = (toString(k.second.start) + "-" + toString(k.second.end));
+                const auto pos = (toString(k.start) + "-" + toString(k.end));
                 o.writer->write((boost::format(format) % cID % pos % "TP").str());
             }
         }
@@ -591,10 +603,15 @@ static void writeQuins(const FileName &file,
              * Calculating base statistics for the genes
              */
             
+            // Reads for the genes
+            std::map<GeneID, Counts> g2r;
+            
             for (const auto &j : stats.eInters.at(cID).data())
             {
                 const auto &gID = j.second.gID();
                 
+                g2r[gID] += i.second.e2r.at(j.second.index());
+                
                 // Statistics for the bases within the gene
                 const auto bs = j.second.stats();
 
@@ -607,10 +624,8 @@ static void writeQuins(const FileName &file,
             // For every gene in the reference
             for (const auto &gID : gtf->genes(cID))
             {
-                const auto &data = i.second;
-                
                 // Number of reads aligned
-                const auto reads = data.g2r.count(gID) ? data.g2r.at(gID) : 0;
+                const auto reads = g2r.count(gID) ? g2r.at(gID) : 0;
 
                 // Sensitivity at the intron level
                 const auto isn = im.count(gID) ? std::to_string(im.at(gID).sn()) : "-";
@@ -54,7 +54,8 @@ namespace Anaquin
                     AlignLevel  aLvl;
                     IntronLevel iLvl;
 
-                    std::map<GeneID, Counts> g2r;
+                    // Reads for the exons (indexed by MergedInterval::index()), summed by genes for reporting
+                    std::vector<Counts> e2r;
                 };
 
                 std::map<ChrID, Data> data;
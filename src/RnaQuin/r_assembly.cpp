@@ -1,5 +1,7 @@
+#include <deque>
 #include <thread>
 #include <fstream>
+#include <exception>
 #include "tools/system.hpp"
 #include "data/compare.hpp"
 #include "tools/gtf_data.hpp"
@@ -8,24 +10,11 @@
 
 using namespace Anaquin;
 
-// Defined for cuffcompare
-Compare __cmp__;
-
-static FileName __QForSyn__;
-static FileName __QForGen__;
-static FileName __RForSyn__;
-static FileName __RForGen__;
-
-static GTFData __RData__;
-static RAssembly::Stats *__Stats__;
-
-static bool __hasGen__;
-
 // Defined in resources.cpp
 extern FileName GTFRef();
 
-// Defined for Cuffcompare
-extern int cuffcompare_main(const char *ref, const char *query);
+// Defined for Cuffcompare (reentrant, the results are written to the Compare)
+extern int cuffcompare_main(const char *ref, const char *query, Compare &);
 
 static std::string exec(const char* cmd)
 {
@@ -82,44 +71,94 @@ static FileName grepVGTF(const FileName &file, const std::string &key)
 
 ChrID __ChrIS__ = "chrIS";
 
-static FileName createQGTFSyn(const FileName &file)
+static void readQueryGTF(const FileName &file, RAssembly::Stats &stats)
 {
-    return (__QForSyn__ = grepGTF(file, __ChrIS__));
+    // Never cached, the query is the user's assembly and is read only once
+    const auto gs = GTFData::read(Reader(file));
+    
+    stats.sExons = gs.countUExonSyn();
+    stats.sIntrs = gs.countUIntrSyn();
+    stats.sTrans = gs.countTransSyn();
+    stats.sGenes = gs.nGeneSyn();
+    stats.gExons = gs.countUExonGen();
+    stats.gIntrs = gs.countUIntrGen();
+    stats.gTrans = gs.countTransGen();
+    stats.gGenes = gs.nGeneGen();
 }
 
-static FileName createQGTFGen(const FileName &file)
+static void readRefGTF(const FileName &file, RAssembly::Stats &stats)
 {
-    return (__QForGen__ = grepVGTF(file, __ChrIS__));
+    const auto gs = gtfData(Reader(file));
+    
+    stats.rsExons = gs.countUExonSyn();
+    stats.rsIntrs = gs.countUIntrSyn();
+    stats.rsTrans = gs.countTransSyn();
+    stats.rsGenes = gs.nGeneSyn();
+    stats.rgExons = gs.countUExonGen();
+    stats.rgIntrs = gs.countUIntrGen();
+    stats.rgTrans = gs.countTransGen();
+    stats.rgGenes = gs.nGeneGen();
 }
 
-static FileName createRGTFSyn(const FileName &file)
-{
-    return (__RForSyn__ = grepGTF(file, __ChrIS__, false));
-}
+/*
+ * Threads running in the background. All threads are joined before the destructor returns (even if
+ * an exception is thrown), join() also rethrows the first exception from the threads.
+ */
 
-static FileName createRGTFGen(const FileName &file)
+class Workers
 {
-    return (__RForGen__ = grepVGTF(file, __ChrIS__));
-}
+    public:
 
-static void readQueryGTF(const FileName &file)
-{
-    const auto gs = gtfData(Reader(file));
-    
-    __Stats__->sExons = gs.countUExonSyn();
-    __Stats__->sIntrs = gs.countUIntrSyn();
-    __Stats__->sTrans = gs.countTransSyn();
-    __Stats__->sGenes = gs.nGeneSyn();
-    __Stats__->gExons = gs.countUExonGen();
-    __Stats__->gIntrs = gs.countUIntrGen();
-    __Stats__->gTrans = gs.countTransGen();
-    __Stats__->gGenes = gs.nGeneGen();
-}
+        ~Workers() { wait(); }
 
-static void readRefGTF(const FileName &file)
-{
-    __RData__ = gtfData(Reader(file));
-}
+        template <typename F> void spawn(F f)
+        {
+            // References into a deque are not invalidated by push_back
+            _errs.push_back(nullptr);
+            auto *err = &_errs.back();
+
+            _threads.push_back(std::thread([=]()
+            {
+                try
+                {
+                    f();
+                }
+                catch (...)
+                {
+                    *err = std::current_exception();
+                }
+            }));
+        }
+
+        inline void join()
+        {
+            wait();
+
+            for (const auto &i : _errs)
+            {
+                if (i)
+                {
+                    std::rethrow_exception(i);
+                }
+            }
+        }
+
+    private:
+
+        inline void wait()
+        {
+            for (auto &i : _threads)
+            {
+                if (i.joinable())
+                {
+                    i.join();
+                }
+            }
+        }
+
+        std::vector<std::thread> _threads;
+        std::deque<std::exception_ptr> _errs;
+};
 
 static RAssembly::Stats init(const RAssembly::Options &o)
 {
@@ -140,79 +179,84 @@ RAssembly::Stats RAssembly::analyze(const FileName &file, const Options &o)
     const auto &r = Standard::instance().r_rna;
 
     auto stats = init(o);
-    __Stats__ = &stats;
 
     /*
      * Filtering transcripts
      */
     
-    auto copyStats = [&](const ChrID &cID)
+    auto copyStats = [&](const ChrID &cID, const Compare &cmp)
     {
-        stats.data[cID].eSN  = std::min(__cmp__.e_sn  / 100.0, 1.0);
-        stats.data[cID].eSP  = std::min(__cmp__.e_sp  / 100.0, 1.0);
-        stats.data[cID].eFSN = std::min(__cmp__.e_fsn / 100.0, 1.0);
-        stats.data[cID].eFSP = std::min(__cmp__.e_fsp / 100.0, 1.0);
-
-        stats.data[cID].iSN  = std::min(__cmp__.i_sn  / 100.0, 1.0);
-        stats.data[cID].iSP  = std::min(__cmp__.i_sp  / 100.0, 1.0);
-        stats.data[cID].iFSN = std::min(__cmp__.i_fsn / 100.0, 1.0);
-        stats.data[cID].iFSP = std::min(__cmp__.i_fsp / 100.0, 1.0);
-
-        stats.data[cID].cSN  = std::min(__cmp__.c_sn  / 100.0, 1.0);
-        stats.data[cID].cSP  = std::min(__cmp__.c_sp  / 100.0, 1.0);
-        stats.data[cID].cFSN = std::min(__cmp__.c_fsn / 100.0, 1.0);
-        stats.data[cID].cFSP = std::min(__cmp__.c_fsp / 100.0, 1.0);
+        stats.data[cID].eSN  = std::min(cmp.e_sn  / 100.0, 1.0);
+        stats.data[cID].eSP  = std::min(cmp.e_sp  / 100.0, 1.0);
+        stats.data[cID].eFSN = std::min(cmp.e_fsn / 100.0, 1.0);
+        stats.data[cID].eFSP = std::min(cmp.e_fsp / 100.0, 1.0);
+
+        stats.data[cID].iSN  = std::min(cmp.i_sn  / 100.0, 1.0);
+        stats.data[cID].iSP  = std::min(cmp.i_sp  / 100.0, 1.0);
+        stats.data[cID].iFSN = std::min(cmp.i_fsn / 100.0, 1.0);
+        stats.data[cID].iFSP = std::min(cmp.i_fsp / 100.0, 1.0);
+
+        stats.data[cID].cSN  = std::min(cmp.c_sn  / 100.0, 1.0);
+        stats.data[cID].cSP  = std::min(cmp.c_sp  / 100.0, 1.0);
+        stats.data[cID].cFSN = std::min(cmp.c_fsn / 100.0, 1.0);
+        stats.data[cID].cFSP = std::min(cmp.c_fsp / 100.0, 1.0);
         
-        stats.data[cID].tSN  = std::min(__cmp__.t_sn  / 100.0, 1.0);
-        stats.data[cID].tSP  = std::min(__cmp__.t_sp  / 100.0, 1.0);
-        stats.data[cID].tFSN = std::min(__cmp__.t_fsn / 100.0, 1.0);
-        stats.data[cID].tFSP = std::min(__cmp__.t_fsp / 100.0, 1.0);
+        stats.data[cID].tSN  = std::min(cmp.t_sn  / 100.0, 1.0);
+        stats.data[cID].tSP  = std::min(cmp.t_sp  / 100.0, 1.0);
+        stats.data[cID].tFSN = std::min(cmp.t_fsn / 100.0, 1.0);
+        stats.data[cID].tFSP = std::min(cmp.t_fsp / 100.0, 1.0);
         
-        stats.data[cID].bSN  = std::min(__cmp__.b_sn  / 100.0, 1.0);
-        stats.data[cID].bSP  = std::min(__cmp__.b_sp  / 100.0, 1.0);
-
-        stats.data[cID].mExonN    = __cmp__.missedExonsN;
-        stats.data[cID].mExonR    = __cmp__.missedExonsR;
-        stats.data[cID].mExonP    = __cmp__.missedExonsP / 100.0;
-        stats.data[cID].mIntronN  = __cmp__.missedIntronsN;
-        stats.data[cID].mIntronR  = __cmp__.missedIntronsR;
-        stats.data[cID].mIntronP  = __cmp__.missedIntronsP / 100.0;
-
-        stats.data[cID].nExonN    = __cmp__.novelExonsN;
-        stats.data[cID].nExonR    = __cmp__.novelExonsR;
-        stats.data[cID].nExonP    = __cmp__.novelExonsP / 100.0;
-        stats.data[cID].nIntronN  = __cmp__.novelIntronsN;
-        stats.data[cID].nIntronR  = __cmp__.novelIntronsR;
-        stats.data[cID].nIntronP  = __cmp__.novelIntronsP / 100.0;
+        stats.data[cID].bSN  = std::min(cmp.b_sn  / 100.0, 1.0);
+        stats.data[cID].bSP  = std::min(cmp.b_sp  / 100.0, 1.0);
+
+        stats.data[cID].mExonN    = cmp.missedExonsN;
+        stats.data[cID].mExonR    = cmp.missedExonsR;
+        stats.data[cID].mExonP    = cmp.missedExonsP / 100.0;
+        stats.data[cID].mIntronN  = cmp.missedIntronsN;
+        stats.data[cID].mIntronR  = cmp.missedIntronsR;
+        stats.data[cID].mIntronP  = cmp.missedIntronsP / 100.0;
+
+        stats.data[cID].nExonN    = cmp.novelExonsN;
+        stats.data[cID].nExonR    = cmp.novelExonsR;
+        stats.data[cID].nExonP    = cmp.novelExonsP / 100.0;
+        stats.data[cID].nIntronN  = cmp.novelIntronsN;
+        stats.data[cID].nIntronR  = cmp.novelIntronsR;
+        stats.data[cID].nIntronP  = cmp.novelIntronsP / 100.0;
     };
     
-    auto compareGTF = [&](const ChrID &cID, const FileName &ref, const FileName &qry)
+    /*
+     * Compare the query against the reference for a chromosome. Safe to run on separate threads, the
+     * results are written only to cmp (and the sequin statistics for the synthetic).
+     */
+    
+    auto compareGTF = [&](const ChrID &cID, const FileName &ref, const FileName &qry, Compare &cmp)
     {
         o.logInfo("Reference: " + ref);
         o.logInfo("Query: " + qry);
         
-        #define CUFFCOMPARE(x, y) { if (cuffcompare_main(x.c_str(), y.c_str())) { throw std::runtime_error("Failed to analyze " + file + ". Please check the file and try again."); } }
+        #define CUFFCOMPARE(x, y) { if (cuffcompare_main(x.c_str(), y.c_str(), cmp)) { throw std::runtime_error("Failed to analyze " + file + ". Please check the file and try again."); } }
 
         // Only required for sensitivity at individual sequins...
         if (isChrIS(cID))
         {
             /*
-             * Calculate sensitivty for each sequin. Unfortunately, there is no simpler way
-             * than Cuffcompare. Cuffcompare doesn't show sensitivity for each isoforms,
-             * thus we'll need to generate a GTF file for each sequin.
+             * Cuffcompare doesn't show sensitivity for each isoforms. The sequins are compared in
+             * process, reading the reference and query only once.
              */
 
+            o.info("Comparing sequins");
+            
+            auto read = [&](const FileName &file)
+            {
+                return System::isEmpty(file) ? RCompare::Transcripts() : RCompare::read(Reader(file), isChrIS);
+            };
+            
+            stats.quins = RCompare::compare(read(ref), read(qry), r.seqsL1());
+            
             for (const auto &i : r.seqsL1())
             {
-                // Generate a new reference GTF solely for the sequins
-                const auto tmp = grepGTF(ref, i);
-                
-                o.analyze(i);
-                
-                // Compare only the sequin against the reference
-                CUFFCOMPARE(tmp, qry);
-                
-                stats.tSPs[i] = __cmp__.b_sn;
+                // Base sensitivity (percentage), as reported by Cuffcompare
+                stats.tSPs[i] = stats.quins.count(i) ? 100.0 * stats.quins.at(i).base.sn() : NAN;
             }
         }
 
@@ -222,8 +266,10 @@ RAssembly::Stats RAssembly::analyze(const FileName &file, const Options &o)
         o.logInfo("Compare complated");
     };
 
-    std::thread t1(readQueryGTF, file);
-    std::thread t2(readRefGTF, GTFRef());
+    Workers reads;
+    
+    reads.spawn([&]() { readQueryGTF(file, stats); });
+    reads.spawn([&]() { readRefGTF(GTFRef(), stats); });
 
     /*
      * Create a new synthetic-only GTF file, which we'll use to estimate sequin sensitivity
@@ -232,51 +278,64 @@ RAssembly::Stats RAssembly::analyze(const FileName &file, const Options &o)
     o.info("Analyzing transcripts");
     o.info("Creating temporary transcripts");
     
-    std::thread t3(createQGTFSyn, file);
-    std::thread t4(createQGTFGen, file);
-    std::thread t5(createRGTFSyn, GTFRef());
-    std::thread t6(createRGTFGen, GTFRef());
-
-    t3.join();
-    t4.join();
-    t5.join();
-    t6.join();
+    FileName qSyn, qGen, rSyn, rGen;
     
-    o.logInfo(__QForSyn__);
-    o.logInfo(__QForGen__);
-    o.logInfo(__RForSyn__);
-    o.logInfo(__RForGen__);
+    {
+        Workers greps;
+        
+        greps.spawn([&]() { qSyn = grepGTF(file, __ChrIS__); });
+        greps.spawn([&]() { qGen = grepVGTF(file, __ChrIS__); });
+        greps.spawn([&]() { rSyn = grepGTF(GTFRef(), __ChrIS__, false); });
+        greps.spawn([&]() { rGen = grepVGTF(GTFRef(), __ChrIS__); });
+        greps.join();
+    }
     
-    A_CHECK(!__QForSyn__.empty(), "Error in __QForSyn__");
-    A_CHECK(!__QForGen__.empty(), "Error in __QForGen__");
-    A_CHECK(!__RForSyn__.empty(), "Error in __RForSyn__");
-    A_CHECK(!__RForGen__.empty(), "Error in __RForGen__");
+    o.logInfo(qSyn);
+    o.logInfo(qGen);
+    o.logInfo(rSyn);
+    o.logInfo(rGen);
+    
+    A_CHECK(!qSyn.empty(), "Error in qSyn");
+    A_CHECK(!qGen.empty(), "Error in qGen");
+    A_CHECK(!rSyn.empty(), "Error in rSyn");
+    A_CHECK(!rGen.empty(), "Error in rGen");
     
     o.info("Temporary transcripts generated");
 
     /*
-     * Comparing for the synthetic
+     * Comparing for the synthetic and the genome at the same time
      */
 
-    o.info("Generating for the synthetic");
-    compareGTF(__ChrIS__, __RForSyn__, __QForSyn__);
-    copyStats(__ChrIS__);
+    auto syn = Compare();
+    auto gen = Compare();
     
-    /*
-     * Comparing for the genome
-     */
+    const auto hasGen = !System::isEmpty(qGen);
 
-    if ((__hasGen__ = !System::isEmpty(__QForGen__)))
     {
-        o.analyze("Genome");
-        compareGTF("endo", __RForGen__, __QForGen__);
-        copyStats("endo");
+        Workers compares;
+        
+        o.info("Generating for the synthetic");
+        compares.spawn([&]() { compareGTF(__ChrIS__, rSyn, qSyn, syn); });
+        
+        if (hasGen)
+        {
+            o.analyze("Genome");
+            compareGTF("endo", rGen, qGen, gen);
+        }
+        
+        compares.join();
+    }
+    
+    copyStats(__ChrIS__, syn);
+
+    if (hasGen)
+    {
+        copyStats("endo", gen);
     }
     
     o.info("Waiting for worker threads to complete");
 
-    t1.join();
-    t2.join();
+    reads.join();
     
     A_CHECK(stats.sExons, "stats.sExons");
 
@@ -306,9 +365,7 @@ static void writeQuins(const FileName &file, const RAssembly::Stats &stats, cons
 
 static void writeSummary(const FileName &file, const RAssembly::Stats &stats, const RAssembly::Options &o)
 {
-    const auto &r = __RData__;
-    
-    const auto hasGen = __hasGen__;
+    const auto hasGen = stats.data.count("endo") > 0;
     const auto sData  = stats.data.at(__ChrIS__);
     const auto gData  = hasGen ? stats.data.at("endo") : RAssembly::Stats::Data();
 
@@ -383,14 +440,14 @@ static void writeSummary(const FileName &file, const RAssembly::Stats &stats, co
     o.writer->open("RnaAssembly_summary.stats");
     o.writer->write((boost::format(format) % file              // 1
                                            % GTFRef()          // 2
-                                           % r.countUExonSyn() // 3
-                                           % r.countUIntrSyn() // 4
-                                           % r.countTransSyn() // 5
-                                           % r.nGeneSyn()  // 6
-                                           % r.countUExonGen() // 7
-                                           % r.countUIntrGen() // 8
-                                           % r.countTransGen() // 9
-                                           % r.nGeneGen()  // 10
+                                           % stats.rsExons     // 3
+                                           % stats.rsIntrs     // 4
+                                           % stats.rsTrans     // 5
+                                           % stats.rsGenes     // 6
+                                           % stats.rgExons     // 7
+                                           % stats.rgIntrs     // 8
+                                           % stats.rgTrans     // 9
+                                           % stats.rgGenes     // 10
                                            % stats.sExons      // 11
                                            % stats.sIntrs      // 12
                                            % stats.sTrans      // 13
@@ -8,6 +8,7 @@
 #define R_ASSEMBLY_HPP
 
 #include "stats/analyzer.hpp"
+#include "RnaQuin/r_compare.hpp"
 
 namespace Anaquin
 {
@@ -78,6 +79,9 @@ namespace Anaquin
             // Sensitivity for each sequin
             std::map<SequinID, Proportion> tSPs;
 
+            // Comparison at all levels for each sequin (only the base level is the same as Cuffcompare)
+            std::map<SequinID, RCompare::Stats> quins;
+
             Counts sExons = 0;
             Counts sIntrs = 0;
             Counts sTrans = 0;
@@ -87,6 +91,18 @@ namespace Anaquin
             Counts gIntrs = 0;
             Counts gTrans = 0;
             Counts gGenes = 0;
+
+            // Reference annotation (synthetic)
+            Counts rsExons = 0;
+            Counts rsIntrs = 0;
+            Counts rsTrans = 0;
+            Counts rsGenes = 0;
+
+            // Reference annotation (genome)
+            Counts rgExons = 0;
+            Counts rgIntrs = 0;
+            Counts rgTrans = 0;
+            Counts rgGenes = 0;
         };
 
         // Analyze for a single sample
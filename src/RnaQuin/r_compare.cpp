@@ -0,0 +1,285 @@
+#include "RnaQuin/r_compare.hpp"
+#include "parsers/parser_gtf.hpp"
+
+// Defined in main.cpp
+extern unsigned __threads__;
+
+using namespace Anaquin;
+
+typedef std::vector<const RCompare::Transcript *> TransPtrs;
+
+// Minimum overlap for matching single-exon transcripts (fraction of the longer transcript)
+static const Proportion MIN_SINGLE_OVERLAP = 0.8;
+
+RCompare::Transcripts RCompare::read(const Reader &r, std::function<bool (const ChrID &)> f)
+{
+    std::map<ChrID, std::map<TransID, Transcript>> c2t;
+
+    ParserGTF::parse(r, [&](const ParserGTF::Data &x, boost::string_ref, const ParserProgress &)
+    {
+        if (x.type != RNAFeature::Exon || !f(x.cID))
+        {
+            return;
+        }
+
+        auto &t = c2t[x.cID][x.tID];
+
+        if (t.exons.empty())
+        {
+            t.tID = x.tID;
+            t.gID = x.gID;
+            t.str = x.str;
+        }
+
+        t.exons.push_back(x.l);
+    }, __threads__);
+
+    Transcripts trans;
+
+    for (auto &i : c2t)
+    {
+        auto &x = trans[i.first];
+
+        for (auto &j : i.second)
+        {
+            auto &t = j.second;
+
+            std::sort(t.exons.begin(), t.exons.end());
+            t.l = Locus(t.exons.front().start, t.exons.back().end);
+
+            for (const auto &e : t.exons)
+            {
+                t.l.end = std::max(t.l.end, e.end);
+            }
+
+            x.push_back(std::move(t));
+        }
+
+        std::sort(x.begin(), x.end(), [&](const Transcript &a, const Transcript &b)
+        {
+            return a.l < b.l;
+        });
+    }
+
+    return trans;
+}
+
+// Introns between the exons (nothing between overlapping or adjacent exons)
+static std::vector<Locus> introns(const RCompare::Transcript &t)
+{
+    std::vector<Locus> r;
+
+    for (auto i = 1; i < t.exons.size(); i++)
+    {
+        if (t.exons[i].start - 1 >= t.exons[i-1].end + 1)
+        {
+            r.push_back(Locus(t.exons[i-1].end + 1, t.exons[i].start - 1));
+        }
+    }
+
+    return r;
+}
+
+static bool matchSingle(const RCompare::Transcript &x, const RCompare::Transcript &y)
+{
+    return x.exons.size() == 1 && y.exons.size() == 1 &&
+           x.l.overlap(y.l) >= MIN_SINGLE_OVERLAP * std::max(x.l.length(), y.l.length());
+}
+
+// Compare the reference transcripts of a sequin against the overlapping query transcripts
+static RCompare::Stats compare(const TransPtrs &ref, const TransPtrs &qry)
+{
+    RCompare::Stats stats;
+
+    /*
+     * Base level, merged exons are intersected
+     */
+
+    auto merged = [&](const TransPtrs &x)
+    {
+        std::vector<Locus> l;
+
+        for (const auto &t : x)
+        {
+            l.insert(l.end(), t->exons.begin(), t->exons.end());
+        }
+
+        return Locus::merge<Locus, Locus>(l);
+    };
+
+    const auto rm = merged(ref);
+    const auto qm = merged(qry);
+
+    for (const auto &i : rm) { stats.base.rN += i.length(); }
+    for (const auto &i : qm) { stats.base.qN += i.length(); }
+
+    for (auto i = 0, j = 0; i < rm.size() && j < qm.size();)
+    {
+        stats.base.rTP += rm[i].overlap(qm[j]);
+
+        if (rm[i].end < qm[j].end)
+        {
+            i++;
+        }
+        else
+        {
+            j++;
+        }
+    }
+
+    stats.base.qTP = stats.base.rTP;
+
+    /*
+     * Exon, intron, intron-chain levels
+     */
+
+    std::set<Locus> re, qe, ri, qi;
+    std::set<std::vector<Locus>> rc, qc;
+
+    auto features = [&](const TransPtrs &x, std::set<Locus> &e, std::set<Locus> &i, std::set<std::vector<Locus>> &c)
+    {
+        for (const auto &t : x)
+        {
+            const auto intrs = introns(*t);
+
+            e.insert(t->exons.begin(), t->exons.end());
+            i.insert(intrs.begin(), intrs.end());
+
+            if (t->exons.size() > 1)
+            {
+                c.insert(intrs);
+            }
+        }
+    };
+
+    features(ref, re, ri, rc);
+    features(qry, qe, qi, qc);
+
+    // Number of features in x found in y, exact matches only (unlike Cuffcompare for terminal exons)
+    auto found = [&](const std::set<Locus> &x, const std::set<Locus> &y)
+    {
+        return std::count_if(x.begin(), x.end(), [&](const Locus &l) { return y.count(l); });
+    };
+
+    stats.exon.rN  = re.size();
+    stats.exon.qN  = qe.size();
+    stats.exon.rTP = found(re, qe);
+    stats.exon.qTP = found(qe, re);
+
+    stats.intr.rN  = ri.size();
+    stats.intr.qN  = qi.size();
+    stats.intr.rTP = found(ri, qi);
+    stats.intr.qTP = found(qi, ri);
+
+    /*
+     * Intron-chain and transcript levels, counted by transcripts. A multi-exon transcript matches if its
+     * intron chain matches, the terminal exons are not compared (unlike Cuffcompare).
+     */
+
+    auto chains = [&](const TransPtrs &x, const TransPtrs &y, const std::set<std::vector<Locus>> &c,
+                      RCompare::Metrics &chain, RCompare::Metrics &trans, bool isRef)
+    {
+        for (const auto &t : x)
+        {
+            auto &cN  = isRef ? chain.rN  : chain.qN;
+            auto &cTP = isRef ? chain.rTP : chain.qTP;
+            auto &tN  = isRef ? trans.rN  : trans.qN;
+            auto &tTP = isRef ? trans.rTP : trans.qTP;
+
+            tN++;
+
+            if (t->exons.size() > 1)
+            {
+                cN++;
+
+                if (c.count(introns(*t)))
+                {
+                    cTP++;
+                    tTP++;
+                }
+            }
+            else if (std::any_of(y.begin(), y.end(), [&](const RCompare::Transcript *u) { return matchSingle(*t, *u); }))
+            {
+                tTP++;
+            }
+        }
+    };
+
+    chains(ref, qry, qc, stats.chain, stats.trans, true);
+    chains(qry, ref, rc, stats.chain, stats.trans, false);
+
+    return stats;
+}
+
+std::map<SequinID, RCompare::Stats> RCompare::compare(const Transcripts &ref, const Transcripts &qry, const std::set<SequinID> &seqs)
+{
+    std::map<SequinID, Stats> r;
+
+    for (const auto &i : ref)
+    {
+        // Reference transcripts for each sequin
+        std::map<SequinID, TransPtrs> s2t;
+
+        for (const auto &t : i.second)
+        {
+            if (seqs.count(t.tID))
+            {
+                s2t[t.tID].push_back(&t);
+            }
+
+            if (t.gID != t.tID && seqs.count(t.gID))
+            {
+                s2t[t.gID].push_back(&t);
+            }
+        }
+
+        if (s2t.empty())
+        {
+            continue;
+        }
+
+        static const std::vector<Transcript> none;
+        const auto &q = qry.count(i.first) ? qry.at(i.first) : none;
+
+        // The furthest end up to each query transcript (sorted by start)
+        std::vector<Base> ends(q.size());
+
+        for (auto k = 0; k < q.size(); k++)
+        {
+            ends[k] = k ? std::max(ends[k-1], q[k].l.end) : q[k].l.end;
+        }
+
+        for (const auto &j : s2t)
+        {
+            auto l = j.second.front()->l;
+
+            for (const auto &t : j.second)
+            {
+                l.merge(t->l);
+            }
+
+            const auto str = j.second.front()->str;
+
+            // Transcripts before b end before the sequin, transcripts from e start after the sequin
+            const auto b = std::lower_bound(ends.begin(), ends.end(), l.start) - ends.begin();
+            const auto e = std::upper_bound(q.begin(), q.end(), l.end, [&](Base x, const Transcript &t)
+            {
+                return x < t.l.start;
+            }) - q.begin();
+
+            TransPtrs qs;
+
+            for (auto k = b; k < e; k++)
+            {
+                if (q[k].l.overlap(l) && (q[k].str == str || q[k].str == Strand::Either || str == Strand::Either))
+                {
+                    qs.push_back(&q[k]);
+                }
+            }
+
+            r[j.first] = ::compare(j.second, qs);
+        }
+    }
+
+    return r;
+}
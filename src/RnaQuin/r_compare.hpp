@@ -0,0 +1,81 @@
+#ifndef R_COMPARE_HPP
+#define R_COMPARE_HPP
+
+#include <map>
+#include <set>
+#include <cmath>
+#include <vector>
+#include <functional>
+#include "data/data.hpp"
+#include "data/locus.hpp"
+#include "data/reader.hpp"
+#include "data/biology.hpp"
+
+namespace Anaquin
+{
+    /*
+     * Comparing assembled transcripts against the reference transcripts of each sequin. Both GTF files
+     * are read once and each sequin is located by searching the sorted query transcripts, rather than
+     * running Cuffcompare for each sequin.
+     *
+     * Query transcripts on the strand of a sequin (or without a strand) overlapping the sequin are
+     * compared. Only the base level is the same as Cuffcompare's, the other levels are defined here and
+     * are stricter or looser than Cuffcompare's:
+     *
+     *   - Exons must match exactly, including terminal exons (Cuffcompare allows the outer ends of
+     *     terminal exons to differ)
+     *   - Introns must match exactly
+     *   - Intron chains match if all introns match
+     *   - Multi-exon transcripts match if their intron chains match (Cuffcompare also requires the
+     *     terminal exons to match), single-exon transcripts match if they overlap at least 80% of
+     *     the longer transcript
+     */
+
+    struct RCompare
+    {
+        struct Transcript
+        {
+            TransID tID;
+            GeneID  gID;
+            Strand  str;
+
+            // Sorted by position
+            std::vector<Locus> exons;
+
+            // Locus spanned by the exons
+            Locus l;
+        };
+
+        // Transcripts for each chromosome, sorted by start
+        typedef std::map<ChrID, std::vector<Transcript>> Transcripts;
+
+        struct Metrics
+        {
+            // Number of reference features and matched
+            Counts rN = 0, rTP = 0;
+
+            // Number of query features and matched
+            Counts qN = 0, qTP = 0;
+
+            inline Proportion sn() const { return rN ? static_cast<Proportion>(rTP) / rN : NAN; }
+            inline Proportion sp() const { return qN ? static_cast<Proportion>(qTP) / qN : NAN; }
+        };
+
+        struct Stats
+        {
+            Metrics base, exon, intr, chain, trans;
+        };
+
+        // Read transcripts from the exons in a GTF file, only for the chromosomes accepted by f
+        static Transcripts read(const Reader &, std::function<bool (const ChrID &)> f);
+
+        /*
+         * Compare each sequin against the query. Reference transcripts for a sequin are those named
+         * by the sequin, or belonging to a gene named by the sequin.
+         */
+
+        static std::map<SequinID, Stats> compare(const Transcripts &ref, const Transcripts &qry, const std::set<SequinID> &);
+    };
+}
+
+#endif
@@ -37,12 +37,11 @@ template <typename T> void update(RExpress::Stats &stats,
                                   const RExpress::Options &o)
 {
     const auto &r = Standard::instance().r_rna;
-    const auto &l = r.seqsL1();
     
     auto cID = x.cID;
     if (cID == "") // TODO: Quick fix for Kallisto
     {
-        cID = r.seqsL1().count(x.id) ? ChrIS() : "endo";
+        cID = r.isSeqL1(x.id) ? ChrIS() : "endo";
     }
     
     if (isChrIS(cID))
@@ -55,7 +54,7 @@ template <typename T> void update(RExpress::Stats &stats,
         {
             case Metrics::Isoform:
             {
-                if (l.count(x.id))
+                if (r.isSeqL1(x.id))
                 {
                     if (!isnan(x.abund) && x.abund)
                     {
@@ -78,7 +77,7 @@ template <typename T> void update(RExpress::Stats &stats,
 
             case Metrics::Gene:
             {
-                const auto m = r.seqsL1().count(x.id);
+                const auto m = r.isSeqL1(x.id);
                 
                 if (m)
                 {
@@ -204,7 +203,7 @@ RExpress::Stats RExpress::analyze(const FileName &file, const Options &o)
             {
                 ParserExpress::Data t;
 
-                ParserGTF::parse(file, [&](const ParserGTF::Data &x, const std::string &, const ParserProgress &p)
+                ParserGTF::parse(file, [&](const ParserGTF::Data &x, boost::string_ref, const ParserProgress &p)
                 {
                     if (p.i && !(p.i % 100000))
                     {
@@ -84,7 +84,7 @@ template <typename T> void classify(RFold::Stats &stats, const T &t, Metrics met
         {
             assert(!t.iID.empty());
             
-            if (r.seqsL1().count(t.iID))
+            if (r.isSeqL1(t.iID))
             {
                 f(t.iID, r.input5(t.iID));
             }
@@ -100,7 +100,7 @@ template <typename T> void classify(RFold::Stats &stats, const T &t, Metrics met
         {
             assert(!t.gID.empty());
             
-            if (r.seqsL2().count(t.gID))
+            if (r.isSeqL2(t.gID))
             {
                 f(t.gID, r.input6(t.gID));
             }
@@ -1,3 +1,4 @@
+#include <mutex>
 #include "tools/errors.hpp"
 #include "RnaQuin/RnaQuin.hpp"
 #include "RnaQuin/r_sample.hpp"
@@ -22,25 +23,35 @@ RSample::Stats RSample::stats(const FileName &file, const Options &o)
 
     o.info("Calculating the coverage before subsampling");
     
-    ParserBAM::parse(file, [&](ParserBAM::Data &x, const ParserBAM::Info &info)
+    // Workers share the logger
+    std::mutex m;
+    
+    typedef RSample::Stats::SGReads SGReads;
+
+    stats.before = ParserBAM::parallel(file, SGReads(), [&](SGReads &x, ParserBAM::Data &y, const ParserBAM::Info &info)
     {
         if (info.p.i && !(info.p.i % 1000000))
         {
+            std::lock_guard<std::mutex> lock(m);
             o.logInfo(std::to_string(info.p.i));
         }
         
         // Don't count for multiple alignments
-        if (x.isPrimary && x.isAligned)
+        if (y.isPrimary && y.isAligned)
         {
-            if (isChrIS(x.cID))
+            if (isChrIS(y.cID))
             {
-                stats.before.syn++;
+                x.syn++;
             }
             else
             {
-                stats.before.gen++;
+                x.gen++;
             }
         }
+    }, [&](SGReads &x, const SGReads &y)
+    {
+        x.syn += y.syn;
+        x.gen += y.gen;
     });
 
     o.info("Alignments mapped to the in-silico (before subsampling): " + std::to_string(stats.before.syn));
@@ -76,7 +87,7 @@ RSample::Stats RSample::stats(const FileName &file, const Options &o)
     o.info("Normalization: "    + std::to_string(stats.norm));
 
     // Perform subsampling
-    const auto r = Sampler::sample(file, stats.norm, o, [&](const ChrID &id) { return isChrIS(id); });
+    const auto r = Sampler::sample(file, SAMWriter::file(o.work + "/RnaSubsample_sampled"), stats.norm, o, [&](const ChrID &id) { return isChrIS(id); });
 
     stats.after = r.after;
 
@@ -1,6 +1,10 @@
 #ifndef VARQUIN_HPP
 #define VARQUIN_HPP
 
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
 #include "data/data.hpp"
 #include "data/variant.hpp"
 
@@ -28,6 +32,65 @@ namespace Anaquin
         }
     }
     
+    // 64-bit FNV-1a of a read name, collisions are negligible for the number of reads
+    inline std::uint64_t hashName(const ReadName &x)
+    {
+        std::uint64_t h = 14695981039346656037ULL;
+        
+        for (const auto c : x)
+        {
+            h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        
+        return h;
+    }
+    
+    /*
+     * Attribute the false positives not matched by position to the sequin regions. FPs are sorted
+     * by position on each chromosome, thus the regions are swept once for each chromosome.
+     */
+    
+    template <typename R, typename T> void attributeFPs(const R &r, std::vector<T> &fps)
+    {
+        std::map<ChrID, std::vector<std::size_t>> c2i;
+        
+        for (auto i = 0; i < fps.size(); i++)
+        {
+            if (!fps[i].var)
+            {
+                c2i[fps[i].qry.cID].push_back(i);
+            }
+        }
+        
+        for (auto &i : c2i)
+        {
+            auto &x = i.second;
+            
+            std::stable_sort(x.begin(), x.end(), [&](std::size_t a, std::size_t b)
+            {
+                return fps[a].qry.l.start < fps[b].qry.l.start;
+            });
+            
+            std::vector<Locus> loci;
+            
+            for (const auto &j : x)
+            {
+                loci.push_back(fps[j].qry.l);
+            }
+            
+            const auto regs = r.findR1(i.first, loci);
+            
+            for (auto j = 0; j < x.size(); j++)
+            {
+                if (regs[j])
+                {
+                    fps[x[j]].rID = regs[j]->id();
+                    A_ASSERT(!fps[x[j]].rID.empty());
+                }
+            }
+        }
+    }
+    
     // Eg: chrev1, chrev10 etc...
     inline bool isRevChr(const ChrID &x)
     {
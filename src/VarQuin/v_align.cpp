@@ -1,3 +1,4 @@
+#include "tools/tasks.hpp"
 #include "tools/tools.hpp"
 #include "VarQuin/v_align.hpp"
 #include "parsers/parser_bam.hpp"
@@ -7,25 +8,28 @@ using namespace Anaquin;
 extern FileName BedRef();
 
 #ifdef DEBUG_VALIGN
+#include <mutex>
 #include <fstream>
+static std::mutex __bMutex__;
 static std::ofstream __bWriter__;
 #endif
 
 static void writeBase(const ChrID &cID, const Locus &l, const Label &label)
 {
 #ifdef DEBUG_VALIGN
+    std::lock_guard<std::mutex> lock(__bMutex__);
     __bWriter__ << cID << "\t" << l.start << "\t" << l.end << "\t" << label << "\n";
 #endif
 }
 
-static void classifyAlign(VAlign::Performance &stats, ParserBAM::Data &align)
+static void classifyAlign(VAlign::Performance::Data *data, MergedIntervals<> *inters, ParserBAM::Data &align)
 {
-    if (!stats.data.count(align.cID))
+    if (!data)
     {
         return;
     }
     
-    auto &x = stats.data.at(align.cID);
+    auto &x = *data;
 
     Locus l;
     bool spliced;
@@ -48,9 +52,9 @@ static void classifyAlign(VAlign::Performance &stats, ParserBAM::Data &align)
             
             const auto covered = (l.length() - lGaps - rGaps);
             
-            stats.data[align.cID].lGaps[m->name()] += lGaps;
-            stats.data[align.cID].lGaps[m->name()] += rGaps;
-            stats.data[align.cID].align[m->name()] += covered;
+            x.lGaps[m->index()] += lGaps;
+            x.rGaps[m->index()] += rGaps;
+            x.align[m->index()] += covered;
             
             A_ASSERT(covered >= 0);
             A_ASSERT(l.length() > lGaps);
@@ -58,7 +62,7 @@ static void classifyAlign(VAlign::Performance &stats, ParserBAM::Data &align)
         };
         
         // Does the read aligned within a region?
-        const auto m = stats.inters.at(align.cID).contains(l);
+        const auto m = inters->contains(l);
 
         if (m)
         {
@@ -67,8 +71,8 @@ static void classifyAlign(VAlign::Performance &stats, ParserBAM::Data &align)
             f(m);
             A_CHECK("lGaps == 0 && rGaps == 0", "No gaps expected for a TP");
             
-            stats.data[align.cID].tp++;
-            x.aLvl.r2r[m->id()]++;
+            x.tp++;
+            x.aLvl.r2r[m->index()]++;
         }
         else
         {
@@ -78,7 +82,7 @@ static void classifyAlign(VAlign::Performance &stats, ParserBAM::Data &align)
             x.afp.push_back(align.name);
             
             // Can we at least match by overlapping?
-            const auto m = stats.inters[align.cID].overlap(l);
+            const auto m = inters->overlap(l);
             
             if (m)
             {
@@ -103,12 +107,12 @@ static void classifyAlign(VAlign::Performance &stats, ParserBAM::Data &align)
                     writeBase(align.cID, gap, "FP");
                 }
                 
-                stats.data[align.cID].fp++;
+                x.fp++;
                 
                 writeBase(align.cID, l, "FP");
             }
 
-            stats.data[align.cID].fp++;
+            x.fp++;
                 
             // Not overlapping with the reference regions
             writeBase(align.cID, l, "FP");
@@ -149,6 +153,14 @@ VAlign::Stats VAlign::analyze(const FileName &endo, const FileName &seqs, const
             
             p.data[cID].bLvl.fp = std::shared_ptr<MergedInterval>(
                     new MergedInterval(cID, Locus(1, std::numeric_limits<Base>::max())));
+            
+            // One entry for each region
+            const auto n = i.second.size();
+            
+            p.data[cID].lGaps.resize(n);
+            p.data[cID].rGaps.resize(n);
+            p.data[cID].align.resize(n);
+            p.data[cID].aLvl.r2r.resize(n);
         }
         
         return stats;
@@ -164,17 +176,32 @@ VAlign::Stats VAlign::analyze(const FileName &endo, const FileName &seqs, const
     __bWriter__.open(o.work + "/VarAlign_qbase.stats");
 #endif
 
-    const auto r2 = r.regs2();
+    const auto &r2 = r.regs2();
+    
+    // Chromosomes resolved for an alignment file
+    struct Index
+    {
+        Index(const Chr2DInters &r2, Performance &p) : r2(r2), data(p.data), inters(p.inters) {}
+        
+        ParserBAM::ChrIndex<const Chr2DInters> r2;
+        ParserBAM::ChrIndex<std::map<ChrID, Performance::Data>> data;
+        ParserBAM::ChrIndex<std::map<ChrID, MergedIntervals<>>> inters;
+    };
     
-    auto classify = [&](ParserBAM::Data &x, const ParserBAM::Info &info, Performance &p)
+    auto classify = [&](ParserBAM::Data &x, const ParserBAM::Info &info, Performance &p, Index &i)
     {
         if (info.p.i && !(info.p.i % 1000000))
         {
             o.wait(std::to_string(info.p.i));
         }
-        else if (!contains(r2, x.cID, x.l))
+        else
         {
-            return;
+            const auto m = i.r2.find(x);
+            
+            if (!m || !m->contains(x.l))
+            {
+                return;
+            }
         }
         
         // Intron? Probably a mistake.
@@ -196,33 +223,43 @@ VAlign::Stats VAlign::analyze(const FileName &endo, const FileName &seqs, const
             return;
         }
         
-        classifyAlign(p, x);
+        classifyAlign(i.data.find(x), i.inters.find(x), x);
     };
     
-    if (!endo.empty())
+    // Each file has its own reader and statistics, thus they can be parsed concurrently
+    auto parse = [&](const FileName &file, Performance *p)
     {
-        /*
-         * Analyzing endogenous alignments
-         */
-        
-        o.analyze(endo);
-        
-        ParserBAM::parse(endo, [&](ParserBAM::Data &x, const ParserBAM::Info &info)
+        return [&, file, p]()
         {
-            classify(x, info, *(stats.endo));
-        });
+            o.analyze(file);
+            
+            Index i(r2, *p);
+            
+            ParserBAM::parse(file, [&](ParserBAM::Data &x, const ParserBAM::Info &info)
+            {
+                classify(x, info, *p, i);
+            });
+        };
+    };
+    
+    std::vector<Task> tasks;
+    
+    /*
+     * Analyzing endogenous alignments
+     */
+    
+    if (!endo.empty())
+    {
+        tasks.push_back(parse(endo, stats.endo.get()));
     }
 
     /*
      * Analyzing sequin alignments
      */
     
-    o.analyze(seqs);
+    tasks.push_back(parse(seqs, stats.seqs.get()));
     
-    ParserBAM::parse(seqs, [&](ParserBAM::Data &x, const ParserBAM::Info &info)
-    {
-        classify(x, info, *(stats.seqs));
-    });
+    runTasks(tasks);
 
 #ifdef DEBUG_VALIGN
     __bWriter__.close();
@@ -273,13 +310,13 @@ VAlign::Stats VAlign::analyze(const FileName &endo, const FileName &seqs, const
                 }
                 else
                 {
+                    const auto &d = p.data.at(cID);
+                    
                     // TP at the base level
-                    const auto btp = p.data.at(cID).align.count(rID) ? p.data.at(cID).align.at(rID) : 0;
+                    const auto btp = d.align.at(m->index());
                     
                     // FP at the base level (requires overlapping)
-                    const auto bfp = (p.data.at(i.first).lGaps.count(rID) ? p.data.at(i.first).lGaps.at(rID) : 0)
-                                                                          +
-                                     (p.data.at(i.first).rGaps.count(rID) ? p.data.at(i.first).rGaps.at(rID) : 0);
+                    const auto bfp = d.lGaps.at(m->index()) + d.rGaps.at(m->index());
                     
                     A_ASSERT(!isnan(btp) && btp >= 0);
                     A_ASSERT(!isnan(bfp) && bfp >= 0);
@@ -497,7 +534,7 @@ void VAlign::writeBQuins(const FileName &file,
             // For each mapped fragment in the region...
             for (const auto &k : j.second._data)
             {
-                const auto pos = (toString(k.second.start) + "-" + toString(k.second.end));
+                const auto pos = (toString(k.start) + "-" + toString(k.end));
                 o.writer->write((boost::format(format) % cID % pos % "TP").str());
             }
             
@@ -545,7 +582,7 @@ void VAlign::writeQuins(const FileName &file, const VAlign::Stats &stats, const
             const auto &x = stats.seqs->data.at(cID);
             
             // Number of reads mapped to the region
-            const auto reads = x.aLvl.r2r.count(sID) ? x.aLvl.r2r.at(sID) : 0;
+            const auto reads = x.aLvl.r2r.at(j.second.index());
             
             o.writer->write((boost::format(format) % sID
                                                    % stats.seqs->length.at(sID)
@@ -28,8 +28,8 @@ namespace Anaquin
                 {
                     Confusion m;
                     
-                    // Regions to reads (sequins for synthetic)
-                    std::map<SequinID, Coverage> r2r;
+                    // Reads for the regions (sequins for synthetic), indexed by MergedInterval::index()
+                    std::vector<Coverage> r2r;
                 };
                 
                 // Base level for a chromosome
@@ -44,9 +44,10 @@ namespace Anaquin
                 // FP alignments (overlaps)
                 std::vector<ReadName> afp;
 
-                std::map<GeneID, Base> lGaps;
-                std::map<GeneID, Base> rGaps;
-                std::map<GeneID, Base> align;
+                // Bases for the regions, indexed by MergedInterval::index()
+                std::vector<Base> lGaps;
+                std::vector<Base> rGaps;
+                std::vector<Base> align;
             };
 
             std::map<ChrID, Data> data;
@@ -1,4 +1,5 @@
 #include <ss/stats.hpp>
+#include "tools/tasks.hpp"
 #include "tools/random.hpp"
 #include "VarQuin/v_trim.hpp"
 #include "VarQuin/v_calibrate.hpp"
@@ -9,6 +10,7 @@ extern Anaquin::FileName BedRef();
 using namespace Anaquin;
 
 ParserBAMBED::Stats VCalibrate::sample(const FileName    &file,
+                                    const FileName    &dst,
                                     const NormFactors &norms,
                                     const Chr2DInters &sampled,
                                     const Chr2DInters &trimmed,
@@ -37,10 +39,15 @@ ParserBAMBED::Stats VCalibrate::sample(const FileName    &file,
 
     o.info("Sampling: " + file);
     
+    if (!dst.empty())
+    {
+        o.generate(dst);
+    }
+    
     SAMWriter writer;
-    writer.open("");
+    writer.open(dst, file);
 
-    return ParserBAMBED::parse(file, sampled, [&](const ParserBAM::Data &x,
+    const auto stats = ParserBAMBED::parse(file, sampled, [&](const ParserBAM::Data &x,
                                                   const ParserBAM::Info &info,
                                                   const DInter *inter)
     {
@@ -100,6 +107,10 @@ ParserBAMBED::Stats VCalibrate::sample(const FileName    &file,
 
         return ParserBAMBED::Response::SKIP_EVERYTHING;
     });
+    
+    writer.close();
+    
+    return stats;
 }
 
 template <typename Stats> Coverage stats2cov(const VCalibrate::Method meth, const Stats &stats)
@@ -130,37 +141,54 @@ VCalibrate::CalibrateStats VCalibrate::check(const FileName &endo,
  
     VCalibrate::CalibrateStats stats;
     
-    // Checking endogenous alignments before sampling
-    stats.es = ParserBAMBED::parse(endo, tRegs, [&](const ParserBAM::Data &x, const ParserBAM::Info &info, const DInter *)
+    /*
+     * Only the sequin regions are needed for the endogenous alignments. If the file is indexed, we
+     * can jump to the regions and take the number of alignments from the index.
+     */
+    
+    const auto indexed = ParserBAM::countMapped(endo, stats.nEndo);
+    
+    if (indexed)
     {
-        if (info.p.i && !(info.p.i % 1000000))
-        {
-            o.logWait(std::to_string(info.p.i));
-        }
-        
-        if (x.mapped)
-        {
-            stats.nEndo++;
-        }
-        
-        return ParserBAMBED::Response::OK;
-    });
+        o.logInfo("Index found for " + endo);
+    }
     
-    // Checking sequin alignments before sampling
-    stats.ss = ParserBAMBED::parse(seqs, tRegs, [&](ParserBAM::Data &x, const ParserBAM::Info &info, const DInter *inter)
+    // The passes share nothing but the regions (read-only), thus they run concurrently
+    runTasks({[&]()
     {
-        if (info.p.i && !(info.p.i % 1000000))
+        // Checking endogenous alignments before sampling
+        stats.es = ParserBAMBED::parse(endo, tRegs, [&](const ParserBAM::Data &x, const ParserBAM::Info &info, const DInter *)
         {
-            o.logWait(std::to_string(info.p.i));
-        }
-        
-        if (x.mapped)
+            if (info.p.i && !(info.p.i % 1000000))
+            {
+                o.logWait(std::to_string(info.p.i));
+            }
+            
+            if (!indexed && x.mapped)
+            {
+                stats.nEndo++;
+            }
+            
+            return ParserBAMBED::Response::OK;
+        }, indexed);
+    }, [&]()
+    {
+        // Checking sequin alignments before sampling
+        stats.ss = ParserBAMBED::parse(seqs, tRegs, [&](ParserBAM::Data &x, const ParserBAM::Info &info, const DInter *inter)
         {
-            stats.nSeqs++;
-        }
-        
-        return ParserBAMBED::Response::OK;
-    });
+            if (info.p.i && !(info.p.i % 1000000))
+            {
+                o.logWait(std::to_string(info.p.i));
+            }
+            
+            if (x.mapped)
+            {
+                stats.nSeqs++;
+            }
+            
+            return ParserBAMBED::Response::OK;
+        });
+    }});
     
     // For each chromosome...
     for (auto &i : tRegs)
@@ -302,7 +330,7 @@ VCalibrate::Stats VCalibrate::analyze(const FileName &endo, const FileName &seqs
     const auto allBeforeSeqsC = stats.cStats.allBeforeSeqsC;
     
     // We have the normalization factors so we can proceed with subsampling.
-    const auto after = VCalibrate::sample(trimmed, norms, regs, tRegs, o);
+    const auto after = VCalibrate::sample(trimmed, SAMWriter::file(o.work + "/VarCalibrate_sampled"), norms, regs, tRegs, o);
     
     stats.afterSeqs = VCalibrate::afterSeqsC(tRegs, stats.c2v, o);
     
@@ -127,7 +127,9 @@ namespace Anaquin
                                  std::map<ChrID, std::map<Locus, SampledInfo>> &c2v,
                                  VCalibrate::Options o);
         
+        // Sample to the output file (empty for the console)
         static ParserBAMBED::Stats sample(const FileName    &,
+                                          const FileName    &,
                                           const NormFactors &,
                                           const Chr2DInters &,
                                           const Chr2DInters &,
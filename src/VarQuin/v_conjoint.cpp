@@ -17,15 +17,19 @@ VConjoint::Stats VConjoint::analyze(const FileName &file, const Options &o)
         stats.data[i];
     }
     
-    ParserBAM::parse(file, [&](ParserBAM::Data &x, const ParserBAM::Info &)
+    return ParserBAM::parallel(file, stats, [&](VConjoint::Stats &x, ParserBAM::Data &y, const ParserBAM::Info &)
     {
-        if (stats.data.count(x.cID))
+        if (x.data.count(y.cID))
         {
-            stats.data[x.cID]++;
+            x.data[y.cID]++;
+        }
+    }, [&](VConjoint::Stats &x, const VConjoint::Stats &y)
+    {
+        for (const auto &i : y.data)
+        {
+            x.data[i.first] += i.second;
         }
     });
-
-    return stats;
 }
 
 static void writeQuins(const FileName &file,
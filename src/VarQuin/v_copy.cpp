@@ -1,5 +1,6 @@
 #include "tools/tools.hpp"
 #include "VarQuin/v_copy.hpp"
+#include "writers/sam_writer.hpp"
 
 using namespace Anaquin;
 
@@ -74,7 +75,7 @@ VCopy::Stats VCopy::analyze(const FileName &endo, const FileName &seqs, const Op
     }
     
     // Perform calibration by subsampling
-    stats.after = VCalibrate::sample(seqs, stats.before.norms, r1, r2, o);
+    stats.after = VCalibrate::sample(seqs, SAMWriter::file(o.work + "/VarCopy_sampled"), stats.before.norms, r1, r2, o);
     
     /*
      * Genomic coverage for sequins and genome
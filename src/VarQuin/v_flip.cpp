@@ -1,38 +1,134 @@
-#include <thread>
 #include <algorithm>
+#include <htslib/thread_pool.h>
 #include "tools/errors.hpp"
 #include "VarQuin/v_flip.hpp"
+#include "VarQuin/v_mates.hpp"
 #include "VarQuin/v_split.hpp"
-#include "writers/file_writer.hpp"
+#include "writers/fastq_writer.hpp"
 
 using namespace Anaquin;
 
+// Defined in main.cpp
+extern bool __gzip__;
+
+// Defined in main.cpp
+extern unsigned __memory__;
+
+// Defined in main.cpp
+extern unsigned __threads__;
+
 static const FileName HANG_1    = "VarFlip_hanging.fq";
 static const FileName FLIPPED_1 = "VarFlip_flipped_1.fq";
 static const FileName FLIPPED_2 = "VarFlip_flipped_2.fq";
 static const FileName AMBIG_1   = "VarFlip_ambiguous_1.fq";
 static const FileName AMBIG_2   = "VarFlip_ambiguous_2.fq";
 
-// Multi-threading...
+// Implementation for writing the flipped reads
 static VFlip::Impl *__impl__;
 
-// Multi-threading...
-VFlip::Stats __stats__;
+// Generated by flipping
+static VFlip::Stats __stats__;
 
-static void VarSplit(const FileName &file, const VFlip::Options &o)
+typedef VFlip::Mate Mate;
+
+// Flip a pair of mates
+static void VarFlip(Mate &x, Mate &y)
 {
-    VSplit::Options o2;
+    typedef VFlip::Status Status;
     
-    o2.work   = o.work;
-    o2.logger = o.logger;
+    auto first  = x.isFirstPair ? &x : &y;
+    auto second = x.isFirstPair ? &y : &x;
     
-    // Generate derived alignment files
-    VSplit::report(file, o2);
+    /*
+     * Only complement reads aligned to the reverse genome
+     */
+    
+    if (first->isReverse)
+    {
+        if (first->isForward)
+        {
+            complement(first->seq);
+        }
+        else
+        {
+            std::reverse(first->seq.begin(), first->seq.end());
+        }
+    }
+    
+    if (second->isReverse)
+    {
+        if (second->isForward)
+        {
+            complement(second->seq);
+        }
+        else
+        {
+            std::reverse(second->seq.begin(), second->seq.end());
+        }
+    }
+    
+    const auto bothRev =  first->isReverse && second->isReverse;
+    const auto bothFor = !first->isReverse && !second->isReverse;
+    const auto anyRev  =  first->isReverse || second->isReverse;
+    const auto anyFor  = !first->isReverse || !second->isReverse;
+    const auto anyMap  =  first->mapped ||  second->mapped;
+    const auto anyNMap = !first->mapped || !second->mapped;
+    
+    VFlip::Status status;
+    
+    if (bothRev && !anyNMap)
+    {
+        status = Status::ReverseReverse;
+    }
+    else if (bothFor && !anyNMap)
+    {
+        status = Status::ForwardForward;
+    }
+    else if (anyRev && anyFor && !anyNMap)
+    {
+        status = Status::ForwardReverse;
+    }
+    else if (anyNMap && anyMap && anyRev)
+    {
+        status = Status::ReverseNotMapped;
+    }
+    else if (anyNMap && anyMap && anyFor)
+    {
+        status = Status::ForwardNotMapped;
+    }
+    else
+    {
+        status = Status::NotMappedNotMapped;
+    }
+    
+    __stats__.counts[status]++;
+    __impl__->process(*first, *second, status);
 }
 
-static void VarFlip(const FileName &file, const VFlip::Options &o)
+// Flip a mate never paired
+static void VarHang(Mate &x, const VFlip::Options &o)
+{
+    typedef VFlip::Status Status;
+    
+    o.logWarn("Unpaired mate: " + x.name);
+    
+    // Compute the complement (but not reverse)
+    complement(x.seq);
+    
+    if (x.isReverse)
+    {
+        __stats__.counts[Status::RevHang]++;
+        __impl__->process(x, x, Status::RevHang);
+    }
+    else
+    {
+        __stats__.counts[Status::ForHang]++;
+        __impl__->process(x, x, Status::ForHang);
+    }
+}
+
+VFlip::Stats VFlip::analyze(const FileName &file, const Options &o)
 {
-    typedef VFlip::Stats Stats;
     typedef VFlip::Status Status;
     
     __stats__.counts[Status::RevHang]            = 0;
@@ -44,145 +140,126 @@ static void VarFlip(const FileName &file, const VFlip::Options &o)
     __stats__.counts[Status::ForwardNotMapped]   = 0;
     __stats__.counts[Status::NotMappedNotMapped] = 0;
     
-    // Required for pooling paired-end reads
-    std::map<ReadName, ParserBAM::Data> seenMates;
+    /*
+     * Mates are adjacent for alignments sorted by names, no mate is required to wait. Otherwise,
+     * mates wait in the store (spilled to disk beyond the memory budget).
+     */
+    
+    const auto byName = ParserBAM::isSorted(file, "queryname");
+    
+    MateStore store(static_cast<std::size_t>(__memory__) << 20, o.work);
     
-    o.logInfo("Parsing: " + o.work + "/VarFlip_sequins.bam");
+    // Current alignment, its mate and the alignment waiting for its mate (only sorted by names)
+    Mate x, y, last;
     
-    ParserBAM::parse(file, [&](ParserBAM::Data &x, const ParserBAM::Info &i)
+    auto waiting = false;
+    
+    Counts nHang = 0;
+    
+    auto hang = [&](Mate &m)
     {
-        if (i.p.i && !(i.p.i % 1000000))
-        {
-            o.wait(std::to_string(i.p.i));
-        }
-        
-        if (!x.mapped)
-        {
-            __stats__.nNA++;
-        }
-        else if (__impl__->isReverse(x.cID))
-        {
-            __stats__.nSeqs++; // Reverse genome
-        }
-        else
-        {
-            __stats__.nEndo++; // Forward genome
-        }
-        
-        if (!x.isPassed || x.isSecondary || x.isSupplement)
-        {
-            return;
-        }
-        
-        A_CHECK(x.isPaired, x.name + " is not pair-ended. Singled-ended not supported.");
-        
-        if (!seenMates.count(x.name))
-        {
-            seenMates[x.name] = x;
-        }
-        else
+        nHang++;
+        VarHang(m, o);
+    };
+    
+    VSplit::Options o2;
+    
+    o2.work   = o.work;
+    o2.logger = o.logger;
+    
+    // Generate derived alignment files
+    VSplit::Splitter split(o2);
+    
+    o.logInfo("Parsing: " + file);
+    
+    // Flipping and splitting share the same parsing
+    ParserBAM::parse(file, std::vector<ParserBAM::Functor>
+    {
+        [&](ParserBAM::Data &i, const ParserBAM::Info &info)
         {
-            auto &seen  = seenMates[x.name];
-            auto first  = seen.isFirstPair ? &seen : &x;
-            auto second = seen.isFirstPair ? &x : &seen;
-            
-            /*
-             * Only complement reads aligned to the reverse genome
-             */
-            
-            if (__impl__->isReverse(first->cID))
+            if (info.p.i && !(info.p.i % 1000000))
             {
-                if (first->isForward)
-                {
-                    complement(first->seq);
-                }
-                else
-                {
-                    std::reverse(first->seq.begin(), first->seq.end());
-                }
+                o.wait(std::to_string(info.p.i));
             }
             
-            if (__impl__->isReverse(second->cID))
+            if (!i.mapped)
             {
-                if (second->isForward)
-                {
-                    complement(second->seq);
-                }
-                else
-                {
-                    std::reverse(second->seq.begin(), second->seq.end());
-                }
+                __stats__.nNA++;
             }
-            
-            const auto bothRev =  __impl__->isReverse(first->cID) && __impl__->isReverse(second->cID);
-            const auto bothFor = !__impl__->isReverse(first->cID) && !__impl__->isReverse(second->cID);
-            const auto anyRev  =  __impl__->isReverse(first->cID) || __impl__->isReverse(second->cID);
-            const auto anyFor  = !__impl__->isReverse(first->cID) || !__impl__->isReverse(second->cID);
-            const auto anyMap  =  first->mapped ||  second->mapped;
-            const auto anyNMap = !first->mapped || !second->mapped;
-            
-            VFlip::Status status;
-            
-            if (bothRev && !anyNMap)
+            else if (__impl__->isReverse(i.cID))
             {
-                status = Status::ReverseReverse;
+                __stats__.nSeqs++; // Reverse genome
             }
-            else if (bothFor && !anyNMap)
+            else
             {
-                status = Status::ForwardForward;
+                __stats__.nEndo++; // Forward genome
             }
-            else if (anyRev && anyFor && !anyNMap)
+            
+            if (!i.isPassed || i.isSecondary || i.isSupplement)
             {
-                status = Status::ForwardReverse;
+                return;
             }
-            else if (anyNMap && anyMap && anyRev)
+            
+            A_CHECK(i.isPaired, i.name + " is not pair-ended. Singled-ended not supported.");
+            
+            x.name        = i.name;
+            x.cID         = i.cID;
+            x.seq         = i.sequence();
+            x.qual        = i.quality();
+            x.flag        = i.flag;
+            x.mapped      = i.mapped;
+            x.isForward   = i.isForward;
+            x.isFirstPair = i.isFirstPair;
+            x.isReverse   = __impl__->isReverse(i.cID);
+            
+            if (!byName)
             {
-                status = Status::ReverseNotMapped;
+                if (store.pair(x, y))
+                {
+                    VarFlip(y, x);
+                }
             }
-            else if (anyNMap && anyMap && anyFor)
+            else if (waiting && last.name == x.name)
             {
-                status = Status::ForwardNotMapped;
+                VarFlip(last, x);
+                waiting = false;
             }
             else
             {
-                status = Status::NotMappedNotMapped;
+                if (waiting)
+                {
+                    hang(last);
+                }
+                
+                std::swap(last, x);
+                waiting = true;
             }
-            
-            __stats__.counts[status]++;
-            __impl__->process(*first, *second, status);
-            seenMates.erase(x.name);
+        },
+        
+        [&](ParserBAM::Data &x, const ParserBAM::Info &i)
+        {
+            split(x, i);
         }
-    }, true);
+    });
     
-    o.logInfo("Found: " + std::to_string(seenMates.size()) + " unpaired mates.");
+    split.close();
     
-    for (auto &i: seenMates)
+    if (waiting)
     {
-        o.logWarn("Unpaired mate: " + i.first);
-        
-        // Compute the complement (but not reverse)
-        complement(i.second.seq);
-        
-        if (__impl__->isReverse(i.second.cID))
-        {
-            __stats__.counts[Status::RevHang]++;
-            __impl__->process(i.second, i.second, Status::RevHang);
-        }
-        else
-        {
-            __stats__.counts[Status::ForHang]++;
-            __impl__->process(i.second, i.second, Status::ForHang);
-        }
+        hang(last);
+    }
+    
+    if (store.spilled())
+    {
+        o.logInfo("Pairing mates spilled to disk");
     }
-}
-
-VFlip::Stats VFlip::analyze(const FileName &file, const Options &o)
-{
-    std::thread t1(VarFlip, file, o);
-    std::thread t2(VarSplit, file, o);
     
-    t1.join();
-    t2.join();
+    store.finish([&](Mate &x, Mate &y)
+    {
+        VarFlip(x, y);
+    }, hang);
+    
+    o.logInfo("Found: " + std::to_string(nHang) + " unpaired mates.");
 
     // Generated by flipping
     return __stats__;
@@ -240,60 +317,51 @@ void VFlip::report(const FileName &file, const Options &o)
     {
         Impl(const Options &o)
         {
-            h1 = std::shared_ptr<FileWriter>(new FileWriter(o.work));
-            a1 = std::shared_ptr<FileWriter>(new FileWriter(o.work));
-            a2 = std::shared_ptr<FileWriter>(new FileWriter(o.work));
-            f1 = std::shared_ptr<FileWriter>(new FileWriter(o.work));
-            f2 = std::shared_ptr<FileWriter>(new FileWriter(o.work));
-
-            h1->open(HANG_1);
-            a1->open(AMBIG_1);
-            a2->open(AMBIG_2);
-            f1->open(FLIPPED_1);
-            f2->open(FLIPPED_2);
+            // Compression shared by all writers
+            if (__gzip__ && __threads__ > 1 && !(pool.pool = hts_tpool_init(__threads__)))
+            {
+                throw std::runtime_error("Failed to create thread pool");
+            }
+            
+            const auto ext = __gzip__ ? ".gz" : "";
+            
+            h1.open(o.work + "/" + HANG_1    + ext, &pool);
+            a1.open(o.work + "/" + AMBIG_1   + ext, &pool);
+            a2.open(o.work + "/" + AMBIG_2   + ext, &pool);
+            f1.open(o.work + "/" + FLIPPED_1 + ext, &pool);
+            f2.open(o.work + "/" + FLIPPED_2 + ext, &pool);
         }
 
-        ~Impl()
+        void close()
         {
-            h1->close();
-            a1->close();
-            a2->close();
-            f1->close();
-            f2->close();
+            h1.close();
+            a1.close();
+            a2.close();
+            f1.close();
+            f2.close();
+            
+            if (pool.pool)
+            {
+                hts_tpool_destroy(pool.pool);
+                pool.pool = nullptr;
+            }
         }
         
         bool isReverse(const ChrID &cID) { return isRevChr(cID); }
 
-        void process(const ParserBAM::Data &x, const ParserBAM::Data &y, VFlip::Status status)
+        void process(const Mate &x, const Mate &y, VFlip::Status status)
         {
-            auto writePaired = [&](std::shared_ptr<FileWriter> p1, std::shared_ptr<FileWriter> p2)
+            auto writePaired = [&](FASTQWriter &p1, FASTQWriter &p2)
             {
-                p1->write("@" + x.name + "/1");
-                p1->write(x.seq);
-                p1->write("+");
-                p1->write(x.qual);
-                p2->write("@" + y.name + "/2");
-                p2->write(y.seq);
-                p2->write("+");
-                p2->write(y.qual);
+                p1.write(x.name, "/1", x.seq, x.qual);
+                p2.write(y.name, "/2", y.seq, y.qual);
             };
             
-            auto writeSingle = [&](std::shared_ptr<FileWriter> p1)
+            auto writeSingle = [&](FASTQWriter &p1)
             {
                 if (x.mapped)
                 {
-                    if (x.isFirstPair)
-                    {
-                        p1->write("@" + x.name + "/1");
-                    }
-                    else
-                    {
-                        p1->write("@" + x.name + "/2");
-                    }
-                    
-                    p1->write(x.seq);
-                    p1->write("+");
-                    p1->write(x.qual);
+                    p1.write(x.name, x.isFirstPair ? "/1" : "/2", x.seq, x.qual);
                 }
             };
             
@@ -326,15 +394,18 @@ void VFlip::report(const FileName &file, const Options &o)
             }
         }
 
-        std::shared_ptr<FileWriter> h1;
-        std::shared_ptr<FileWriter> a1, a2;
-        std::shared_ptr<FileWriter> f1, f2;
+        FASTQWriter h1;
+        FASTQWriter a1, a2;
+        FASTQWriter f1, f2;
+        
+        htsThreadPool pool = { nullptr, 0 };
     };
     
     Impl impl(o);
     __impl__ = &impl;
 
     const auto stats = analyze(file, o);
+    impl.close();
     
     /*
      * Generating VarFlip_summary.stats
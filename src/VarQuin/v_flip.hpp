@@ -30,10 +30,32 @@ namespace Anaquin
             std::map<VFlip::Status, Counts> counts;
         };
 
+        // Fields of an alignment required for flipping
+        struct Mate
+        {
+            ReadName name;
+            
+            // Chromosome of the alignment
+            ChrID cID;
+            
+            std::string seq;
+            std::string qual;
+            
+            // Bitwise FLAG
+            int flag;
+            
+            bool mapped;
+            bool isForward;
+            bool isFirstPair;
+            
+            // Aligned to the reverse genome?
+            bool isReverse;
+        };
+        
         struct Impl
         {
             virtual bool isReverse(const ChrID &) = 0;
-            virtual void process(const ParserBAM::Data &, const ParserBAM::Data &, Status) = 0;
+            virtual void process(const Mate &, const Mate &, Status) = 0;
         };
 
         static Stats analyze(const FileName &, const Options &);
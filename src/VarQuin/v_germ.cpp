@@ -48,7 +48,7 @@ static Scripts createROC(const FileName &file, const std::string &score, const s
 
 VGerm::EStats VGerm::analyzeE(const FileName &file, const Options &o)
 {
-    const auto r2 = Standard::instance().r_var.regs2();
+    const auto &r2 = Standard::instance().r_var.regs2();
     
     VGerm::EStats stats;
 
@@ -62,7 +62,7 @@ VGerm::EStats VGerm::analyzeE(const FileName &file, const Options &o)
     
     if (!file.empty())
     {
-        ParserVCF::parse(file, [&](const Variant &x)
+        const auto indexed = ParserVCF::parseRegions(file, r2, [&](const Variant &x)
         {
             if (o.meth == VGerm::Method::Passed && x.filter != Filter::Pass)
             {
@@ -73,7 +73,12 @@ VGerm::EStats VGerm::analyzeE(const FileName &file, const Options &o)
                 stats.g2c[x.gt]++;
                 stats.v2c[x.type()]++;
             }
-        });
+        }, ParserVCF::Fields({}, { VCFFormat::GT }));
+        
+        if (!indexed)
+        {
+            o.logInfo("No index found for " + file + ". Parsing all variants.");
+        }
     }
 
     return stats;
@@ -160,28 +165,6 @@ VGerm::SStats VGerm::analyzeS(const FileName &file, const Options &o)
                 m.rID = m.var->name;
                 A_ASSERT(!m.rID.empty());
             }
-            else
-            {
-                MergedIntervals<> inters;
-                
-                try
-                {
-                    // We should to search where the FPs are
-                    inters = r.mInters(x.cID);
-                    
-                    A_ASSERT(inters.size());
-                    
-                    const auto m2 = inters.contains(x.l);
-                    
-                    // Can we find the corresponding region for the FP?
-                    if (m2)
-                    {
-                        m.rID = m2->id();
-                        A_ASSERT(!m.rID.empty());
-                    }
-                }
-                catch (...) {}
-            }
             
             return m;
         };
@@ -227,7 +210,10 @@ VGerm::SStats VGerm::analyzeS(const FileName &file, const Options &o)
                 stats.fps.push_back(m);
             }
         }
-    });
+    }, ParserVCF::Fields({ VCFInfo::AF, VCFInfo::DP }, { VCFFormat::GT, VCFFormat::AD }));
+    
+    // Which regions are the FPs in?
+    attributeFPs(r, stats.fps);
     
     wTP.close();
     wFP.close();
@@ -653,7 +639,7 @@ template <typename T, typename O> void writeFN(const FileName &file, const T &x,
         {
             wFN.write(x.hdr, x.line);
         }
-    });
+    }, ParserVCF::Fields());
     
     wFN.close();
 }
@@ -0,0 +1,450 @@
+#ifndef V_MATES_HPP
+#define V_MATES_HPP
+
+#include <cstdio>
+#include <limits>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <boost/utility/string_ref.hpp>
+#include "VarQuin/v_flip.hpp"
+
+namespace Anaquin
+{
+    /*
+     * Mates waiting for their mates in VarFlip. Mates are packed into an arena (only the fields
+     * required for flipping) and indexed by an open-addressing table keyed by the hash of the read
+     * name. Mates are spilled to disk (partitioned by the hash) once the memory budget is reached,
+     * spilled partitions are paired one at a time by finish().
+     */
+
+    class MateStore
+    {
+        public:
+
+            typedef VFlip::Mate Mate;
+
+            MateStore(std::size_t budget, const Path &dir) : _budget(budget), _dir(dir)
+            {
+                reset(MIN_SLOTS);
+            }
+
+            ~MateStore()
+            {
+                for (auto i = 0; i < _files.size(); i++)
+                {
+                    if (_files[i])
+                    {
+                        fclose(_files[i]);
+                        std::remove(spillFile(i).c_str());
+                    }
+                }
+            }
+
+            MateStore(const MateStore &) = delete;
+            MateStore &operator=(const MateStore &) = delete;
+
+            /*
+             * Take out the mate of x if it's waiting, otherwise x is stored until its mate arrives.
+             * Returns true if the mate is found.
+             */
+
+            inline bool pair(const Mate &x, Mate &mate)
+            {
+                const auto h = hashName(x.name);
+                const auto i = find(h, x.name);
+
+                if (i != NONE)
+                {
+                    unpack(_slots[i].off, mate);
+                    erase(i);
+                    return true;
+                }
+
+                insert(h, x);
+
+                if (memory() > _budget)
+                {
+                    spill();
+                }
+
+                return false;
+            }
+
+            // Number of mates waiting in memory
+            inline std::size_t size() const { return _n; }
+
+            // Whether any mate has been spilled to disk
+            inline bool spilled() const { return !_files.empty(); }
+
+            /*
+             * Pair the mates spilled to disk. Paired mates are given to f, g is called for mates
+             * never paired (sorted by name within each partition).
+             */
+
+            template <typename F, typename G> void finish(F f, G g)
+            {
+                if (!spilled())
+                {
+                    return hanging(g);
+                }
+
+                // Everything is now on disk
+                spill();
+
+                Mate x, y;
+
+                for (auto i = 0; i < _files.size(); i++)
+                {
+                    if (!_files[i])
+                    {
+                        continue;
+                    }
+
+                    rewind(_files[i]);
+
+                    // Each partition has a fraction of the mates, assume it fits into memory
+                    MateStore s(std::numeric_limits<std::size_t>::max(), _dir);
+
+                    while (read(_files[i], x))
+                    {
+                        if (s.pair(x, y))
+                        {
+                            f(x, y);
+                        }
+                    }
+
+                    s.hanging(g);
+                }
+            }
+
+        private:
+
+            // Initial number of slots in the table (power of two)
+            static const std::size_t MIN_SLOTS = 1024;
+
+            // Number of partitions for spilling
+            static const std::size_t PARTITIONS = 16;
+
+            static const std::uint64_t EMPTY = ~0ULL;
+            static const std::uint64_t TOMB  = ~0ULL - 1;
+
+            static const std::size_t NONE = ~std::size_t(0);
+
+            struct Slot
+            {
+                // Hash of the read name
+                std::uint64_t h;
+
+                // Offset of the packed mate in the arena (EMPTY or TOMB if not used)
+                std::uint64_t off;
+            };
+
+            // Packed in front of the name, chromosome, sequence and quality
+            struct Packed
+            {
+                // Number of bytes for the name, chromosome, sequence and quality
+                std::uint32_t l[4];
+                
+                // Bitwise FLAG
+                std::uint16_t flag;
+                
+                // Mapped, forward, first pair and reverse genome
+                std::uint8_t bits;
+            };
+
+            // Bytes of the packed lengths and flags
+            static const std::size_t PACKED_SIZE = sizeof(Packed::l) + sizeof(std::uint16_t) + sizeof(std::uint8_t);
+
+            inline std::size_t memory() const
+            {
+                return _arena.size() + _slots.size() * sizeof(Slot);
+            }
+
+            inline FileName spillFile(std::size_t i) const
+            {
+                return _dir + "/VarFlip_mates_" + std::to_string(i) + ".tmp";
+            }
+
+            static inline Packed packed(const char *x)
+            {
+                Packed p;
+
+                memcpy(p.l,     x, sizeof(p.l));    x += sizeof(p.l);
+                memcpy(&p.flag, x, sizeof(p.flag)); x += sizeof(p.flag);
+                p.bits = static_cast<std::uint8_t>(*x);
+
+                return p;
+            }
+
+            static inline std::size_t length(const Packed &p)
+            {
+                return PACKED_SIZE + p.l[0] + p.l[1] + p.l[2] + p.l[3];
+            }
+
+            // Fill the mate from the packed fields followed by the strings
+            static inline void unpack(const Packed &p, const char *s, Mate &x)
+            {
+                x.name.assign(s, p.l[0]); s += p.l[0];
+                x.cID.assign (s, p.l[1]); s += p.l[1];
+                x.seq.assign (s, p.l[2]); s += p.l[2];
+                x.qual.assign(s, p.l[3]);
+
+                x.flag        = p.flag;
+                x.mapped      = p.bits & 1;
+                x.isForward   = p.bits & 2;
+                x.isFirstPair = p.bits & 4;
+                x.isReverse   = p.bits & 8;
+            }
+
+            inline Packed packed(std::uint64_t off) const { return packed(&_arena[off]); }
+
+            // Number of bytes for the packed mate
+            inline std::size_t length(std::uint64_t off) const { return length(packed(off)); }
+
+            inline bool sameName(std::uint64_t off, const ReadName &x) const
+            {
+                return packed(off).l[0] == x.size() && !memcmp(&_arena[off + PACKED_SIZE], x.data(), x.size());
+            }
+
+            inline void unpack(std::uint64_t off, Mate &x) const
+            {
+                unpack(packed(off), &_arena[off + PACKED_SIZE], x);
+            }
+
+            inline std::uint64_t pack(const Mate &x)
+            {
+                const auto off = _arena.size();
+
+                Packed k;
+                
+                k.l[0] = x.name.size();
+                k.l[1] = x.cID.size();
+                k.l[2] = x.seq.size();
+                k.l[3] = x.qual.size();
+                k.flag = x.flag;
+                k.bits = (x.mapped      ? 1 : 0) |
+                         (x.isForward   ? 2 : 0) |
+                         (x.isFirstPair ? 4 : 0) |
+                         (x.isReverse   ? 8 : 0);
+
+                _arena.resize(off + length(k));
+
+                auto *p = &_arena[off];
+
+                memcpy(p, k.l,     sizeof(k.l));    p += sizeof(k.l);
+                memcpy(p, &k.flag, sizeof(k.flag)); p += sizeof(k.flag);
+                *p++ = static_cast<char>(k.bits);
+
+                memcpy(p, x.name.data(), k.l[0]); p += k.l[0];
+                memcpy(p, x.cID.data(),  k.l[1]); p += k.l[1];
+                memcpy(p, x.seq.data(),  k.l[2]); p += k.l[2];
+                memcpy(p, x.qual.data(), k.l[3]);
+
+                return off;
+            }
+
+            inline std::size_t find(std::uint64_t h, const ReadName &x) const
+            {
+                const auto mask = _slots.size() - 1;
+
+                for (auto i = h & mask;; i = (i + 1) & mask)
+                {
+                    const auto &s = _slots[i];
+
+                    if (s.off == EMPTY)
+                    {
+                        return NONE;
+                    }
+                    else if (s.off != TOMB && s.h == h && sameName(s.off, x))
+                    {
+                        return i;
+                    }
+                }
+            }
+
+            inline void place(std::uint64_t h, std::uint64_t off)
+            {
+                const auto mask = _slots.size() - 1;
+
+                for (auto i = h & mask;; i = (i + 1) & mask)
+                {
+                    auto &s = _slots[i];
+
+                    if (s.off == EMPTY || s.off == TOMB)
+                    {
+                        _tombs -= (s.off == TOMB);
+                        s.h   = h;
+                        s.off = off;
+                        _n++;
+                        return;
+                    }
+                }
+            }
+
+            inline void insert(std::uint64_t h, const Mate &x)
+            {
+                // Keep the load (including removed mates) under 70%
+                if (10 * (_n + _tombs + 1) > 7 * _slots.size())
+                {
+                    rehash();
+                }
+
+                place(h, pack(x));
+            }
+
+            inline void erase(std::size_t i)
+            {
+                _waste += length(_slots[i].off);
+                _slots[i].off = TOMB;
+                _tombs++;
+                _n--;
+            }
+
+            // Resize the table for the waiting mates and drop the removed mates from the arena
+            inline void rehash()
+            {
+                auto n = MIN_SLOTS;
+
+                while (10 * (_n + 1) > 3 * n)
+                {
+                    n *= 2;
+                }
+
+                const auto slots = std::move(_slots);
+                const auto arena = std::move(_arena);
+
+                reset(n);
+                _arena.reserve(arena.size() - _waste);
+
+                for (const auto &s : slots)
+                {
+                    if (s.off != EMPTY && s.off != TOMB)
+                    {
+                        const auto off = _arena.size();
+                        const auto *p  = &arena[s.off];
+
+                        _arena.insert(_arena.end(), p, p + length(packed(p)));
+                        place(s.h, off);
+                    }
+                }
+
+                _waste = 0;
+            }
+
+            inline void reset(std::size_t n)
+            {
+                _slots.assign(n, Slot { 0, EMPTY });
+                _arena.clear();
+                _n = _tombs = _waste = 0;
+            }
+
+            // Move the waiting mates to the partitions on disk
+            inline void spill()
+            {
+                if (_files.empty())
+                {
+                    _files.resize(PARTITIONS, nullptr);
+                }
+
+                for (const auto &s : _slots)
+                {
+                    if (s.off != EMPTY && s.off != TOMB)
+                    {
+                        // High bits for the partitions, low bits are used by the table
+                        const auto i = (s.h >> 32) % PARTITIONS;
+
+                        if (!_files[i] && !(_files[i] = fopen(spillFile(i).c_str(), "w+b")))
+                        {
+                            throw std::runtime_error("Failed to open: " + spillFile(i));
+                        }
+
+                        if (fwrite(&_arena[s.off], 1, length(s.off), _files[i]) != length(s.off))
+                        {
+                            throw std::runtime_error("Failed to write: " + spillFile(i));
+                        }
+                    }
+                }
+
+                reset(MIN_SLOTS);
+                _arena.shrink_to_fit();
+            }
+
+            // Read a spilled mate, returns false at the end of the file
+            inline bool read(FILE *f, Mate &x)
+            {
+                char b[PACKED_SIZE];
+
+                if (fread(b, 1, PACKED_SIZE, f) != PACKED_SIZE)
+                {
+                    return false;
+                }
+
+                const auto p = packed(b);
+                const auto n = length(p) - PACKED_SIZE;
+
+                _buf.resize(n);
+
+                if (n && fread(&_buf[0], 1, n, f) != n)
+                {
+                    throw std::runtime_error("Corrupted spilled mates");
+                }
+
+                unpack(p, _buf.data(), x);
+                return true;
+            }
+
+            template <typename G> void hanging(G g)
+            {
+                std::vector<std::uint64_t> x;
+
+                for (const auto &s : _slots)
+                {
+                    if (s.off != EMPTY && s.off != TOMB)
+                    {
+                        x.push_back(s.off);
+                    }
+                }
+
+                auto name = [&](std::uint64_t off)
+                {
+                    return boost::string_ref(&_arena[off + PACKED_SIZE], packed(off).l[0]);
+                };
+
+                std::sort(x.begin(), x.end(), [&](std::uint64_t i, std::uint64_t j)
+                {
+                    return name(i) < name(j);
+                });
+
+                Mate m;
+
+                for (const auto &i : x)
+                {
+                    unpack(i, m);
+                    g(m);
+                }
+            }
+
+            // Memory allowed before spilling (bytes)
+            const std::size_t _budget;
+
+            // Directory for spilling
+            const Path _dir;
+
+            std::vector<Slot> _slots;
+
+            // Packed mates (including removed mates until rehashed)
+            std::vector<char> _arena;
+
+            // Number of mates, removed slots and bytes of removed mates
+            std::size_t _n, _tombs, _waste;
+
+            // Partitions on disk (created on the first spilling)
+            std::vector<FILE *> _files;
+
+            // Buffer for reading spilled mates
+            std::vector<char> _buf;
+    };
+}
+
+#endif
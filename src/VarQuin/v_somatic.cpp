@@ -67,7 +67,7 @@ static Scripts createROC(const FileName &file, const std::string &score, const s
 
 VSomatic::EStats VSomatic::analyzeE(const FileName &file, const Options &o)
 {
-    const auto r2 = Standard::instance().r_var.regs2();
+    const auto &r2 = Standard::instance().r_var.regs2();
     
     VSomatic::EStats stats;
     
@@ -81,7 +81,7 @@ VSomatic::EStats VSomatic::analyzeE(const FileName &file, const Options &o)
     
     if (!file.empty())
     {
-        ParserVCF::parse(file, [&](const Variant &x)
+        const auto indexed = ParserVCF::parseRegions(file, r2, [&](const Variant &x)
         {
             if (o.meth == VSomatic::Method::Passed && x.filter != Filter::Pass)
             {
@@ -92,7 +92,12 @@ VSomatic::EStats VSomatic::analyzeE(const FileName &file, const Options &o)
                 stats.g2c[x.gt]++;
                 stats.v2c[x.type()]++;
             }
-        });
+        }, ParserVCF::Fields({}, { VCFFormat::GT }));
+        
+        if (!indexed)
+        {
+            o.logInfo("No index found for " + file + ". Parsing all variants.");
+        }
     }
     
     return stats;
@@ -104,28 +109,23 @@ VSomatic::EStats VSomatic::analyzeE(const FileName &file, const Options &o)
 
 static bool isStrelka(const Variant &x)
 {
+    // Tier-1 and tier-2 counts for the normal (first) and tumor (second) sample
+    auto has = [&](VCFFormat f)
+    {
+        return x.hasFormat(f, 0, 0) &&
+               x.hasFormat(f, 0, 1) &&
+               x.hasFormat(f, 1, 0) &&
+               x.hasFormat(f, 1, 1);
+    };
+    
     auto isSNP = [&]()
     {
-        return x.fi.count("AU_2_1") &&
-               x.fi.count("CU_2_1") &&
-               x.fi.count("GU_2_1") &&
-               x.fi.count("TU_2_1") &&
-               x.fi.count("AU_2_2") &&
-               x.fi.count("CU_2_2") &&
-               x.fi.count("GU_2_2") &&
-               x.fi.count("TU_2_2");
+        return has(VCFFormat::AU) && has(VCFFormat::CU) && has(VCFFormat::GU) && has(VCFFormat::TU);
     };
     
     auto isInd = [&]()
     {
-        return x.fi.count("TAR_1_1") &&
-               x.fi.count("TAR_1_2") &&
-               x.fi.count("TAR_2_1") &&
-               x.fi.count("TAR_2_2") &&
-               x.fi.count("TIR_1_1") &&
-               x.fi.count("TIR_1_2") &&
-               x.fi.count("TIR_2_1") &&
-               x.fi.count("TIR_2_2");
+        return has(VCFFormat::TAR) && has(VCFFormat::TIR);
     };
 
     assert(isSNP() || isInd());
@@ -138,18 +138,18 @@ static Counts strelkaNormalT(const Variant &x, const Sequence &a)
     {
         case SNP:
         {
-            if (a == "A") { return x.fi.at("AU_1_1"); }
-            if (a == "C") { return x.fi.at("CU_1_1"); }
-            if (a == "G") { return x.fi.at("GU_1_1"); }
-            else          { return x.fi.at("TU_1_1"); }
+            if (a == "A") { return x.format(VCFFormat::AU, 0); }
+            if (a == "C") { return x.format(VCFFormat::CU, 0); }
+            if (a == "G") { return x.format(VCFFormat::GU, 0); }
+            else          { return x.format(VCFFormat::TU, 0); }
             break;
         }
 
         case Deletion:
         case Insertion:
         {
-            if (a == x.ref)      { return x.fi.at("TAR_1_1"); }
-            else if (a == x.alt) { return x.fi.at("TIR_1_1"); }
+            if (a == x.ref)      { return x.format(VCFFormat::TAR, 0); }
+            else if (a == x.alt) { return x.format(VCFFormat::TIR, 0); }
             else { throw std::runtime_error("Unknown: " + a); }
         }
 
@@ -163,18 +163,18 @@ static Counts strelkaTumorT(const Variant &x, const Sequence &a)
     {
         case SNP:
         {
-            if (a == "A") { return x.fi.at("AU_2_1"); }
-            if (a == "C") { return x.fi.at("CU_2_1"); }
-            if (a == "G") { return x.fi.at("GU_2_1"); }
-            else          { return x.fi.at("TU_2_1"); }
+            if (a == "A") { return x.format(VCFFormat::AU, 1); }
+            if (a == "C") { return x.format(VCFFormat::CU, 1); }
+            if (a == "G") { return x.format(VCFFormat::GU, 1); }
+            else          { return x.format(VCFFormat::TU, 1); }
             break;
         }
             
         case Deletion:
         case Insertion:
         {
-            if (a == x.ref)      { return x.fi.at("TAR_2_1"); }
-            else if (a == x.alt) { return x.fi.at("TIR_2_1"); }
+            if (a == x.ref)      { return x.format(VCFFormat::TAR, 1); }
+            else if (a == x.alt) { return x.format(VCFFormat::TIR, 1); }
             else { throw std::runtime_error("Unknown: " + a); }
         }
 
@@ -251,18 +251,17 @@ static Proportion tumorDPV(const Variant &x)
 // Measured allele frequency for normal
 static Proportion normalAF(const Variant &x)
 {
-    if (x.ff.count("AF_1"))    { return x.ff.at("AF_1");    }
-    else if (isStrelka(x))     { return strelkaNormalAF(x); }
-    else                       { return NAN; }
+    if (x.hasFormat(VCFFormat::AF, 0)) { return x.format(VCFFormat::AF, 0); }
+    else if (isStrelka(x))             { return strelkaNormalAF(x); }
+    else                               { return NAN; }
 }
 
 // Measured allele frequency for tumor
 static Proportion tumorAF(const Variant &x)
 {
-    if (x.ff.count("AF_2"))    { return x.ff.at("AF_2");   }
-    else if (x.ff.count("AF")) { return x.ff.at("AF");     }
-    else if (isStrelka(x))     { return strelkaTumorAF(x); }
-    else                       { return NAN; }
+    if (x.hasFormat(VCFFormat::AF, 1)) { return x.format(VCFFormat::AF, 1); }
+    else if (isStrelka(x))             { return strelkaTumorAF(x); }
+    else                               { return NAN; }
 }
 
 VSomatic::SStats VSomatic::analyzeS(const FileName &file, const Options &o)
@@ -305,10 +304,12 @@ VSomatic::SStats VSomatic::analyzeS(const FileName &file, const Options &o)
     auto wFP = VCFWriter(); wFP.open(o.work + "/VarSomatic_FP.vcf");
     
     // Caller specific fields
-    const auto keys = std::set<std::string>
+    auto extras = [&](const Variant &x, long key)
     {
-        "SomaticEVS", "QSS", "QSI",
-    };;
+        if (x.hasInfo(VCFInfo::QSS))        { stats.si["QSS"][key] = x.info(VCFInfo::QSS); }
+        if (x.hasInfo(VCFInfo::QSI))        { stats.si["QSI"][key] = x.info(VCFInfo::QSI); }
+        if (x.hasInfo(VCFInfo::SomaticEVS)) { stats.sf["SomaticEVS"][key] = x.info(VCFInfo::SomaticEVS); }
+    };
     
     ParserVCF::parse(file, [&](const Variant &x)
     {
@@ -343,28 +344,6 @@ VSomatic::SStats VSomatic::analyzeS(const FileName &file, const Options &o)
                 m.rID = m.var->name;
                 A_ASSERT(!m.rID.empty());
             }
-            else
-            {
-                MergedIntervals<> inters;
-                
-                try
-                {
-                    // We should to search where the FPs are
-                    inters = r.mInters(x.cID);
-                    
-                    A_ASSERT(inters.size());
-                    
-                    const auto m2 = inters.contains(x.l);
-                    
-                    // Can we find the corresponding region for the FP?
-                    if (m2)
-                    {
-                        m.rID = m2->id();
-                        A_ASSERT(!m.rID.empty());
-                    }
-                }
-                catch (...) {}
-            }
             
             return m;
         };
@@ -378,13 +357,7 @@ VSomatic::SStats VSomatic::analyzeS(const FileName &file, const Options &o)
         {
             if (isSomatic(*m.var))
             {
-                for (const auto &i : keys)
-                {
-                    if (x.fi.count(i))  { stats.si[i][m.var->key()] = x.fi.at(i);  }
-                    if (x.ff.count(i))  { stats.sf[i][m.var->key()] = x.ff.at(i);  }
-                    if (x.ifi.count(i)) { stats.si[i][m.var->key()] = x.ifi.at(i); }
-                    if (x.iff.count(i)) { stats.sf[i][m.var->key()] = x.iff.at(i); }
-                }
+                extras(x, m.var->key());
                 
                 wTP.write(x.hdr, x.line);
                 
@@ -413,13 +386,7 @@ VSomatic::SStats VSomatic::analyzeS(const FileName &file, const Options &o)
             // Ignore anything for germline
             if (!r.findV2(x.cID, x.l))
             {
-                for (const auto &i : keys)
-                {
-                    if (x.fi.count(i))  { stats.si[i][x.key()] = x.fi.at(i);  }
-                    if (x.ff.count(i))  { stats.sf[i][x.key()] = x.ff.at(i);  }
-                    if (x.ifi.count(i)) { stats.si[i][x.key()] = x.ifi.at(i); }
-                    if (x.iff.count(i)) { stats.sf[i][x.key()] = x.iff.at(i); }
-                }
+                extras(x, x.key());
                 
                 wFP.write(x.hdr, x.line);
                 
@@ -427,7 +394,19 @@ VSomatic::SStats VSomatic::analyzeS(const FileName &file, const Options &o)
                 stats.fps.push_back(m);
             }
         }
-    });
+    }, ParserVCF::Fields({ VCFInfo::QSS, VCFInfo::QSI, VCFInfo::SomaticEVS },
+                         { VCFFormat::GT,
+                           VCFFormat::AF,
+                           VCFFormat::DP,
+                           VCFFormat::TAR,
+                           VCFFormat::TIR,
+                           VCFFormat::AU,
+                           VCFFormat::CU,
+                           VCFFormat::GU,
+                           VCFFormat::TU }));
+    
+    // Which regions are the FPs in?
+    attributeFPs(r, stats.fps);
     
     wTP.close();
     wFP.close();
@@ -618,8 +597,7 @@ static void writeQuins(const FileName &file,
             // This shouldn't fail...
             const auto &sv = r.findSeqVar1(i.key());
 
-            #define FORMAT_I(x) (c.fi.count(x) ? toString(c.fi.at(x)) : "-")
-            #define FORMAT_F(x) (c.ff.count(x) ? toString(c.ff.at(x)) : "-")
+            #define FORMAT_I(f, s) (c.hasFormat(f, s) ? toString(static_cast<int>(c.format(f, s))) : "-")
             
             if (isTP)
             {
@@ -634,8 +612,8 @@ static void writeQuins(const FileName &file,
                                                        % normalDPV(c)
                                                        % tumorDPR(c)
                                                        % tumorDPV(c)
-                                                       % FORMAT_I("DP_1")
-                                                       % FORMAT_I("DP_2")
+                                                       % FORMAT_I(VCFFormat::DP, 0)
+                                                       % FORMAT_I(VCFFormat::DP, 1)
                                                        % r.af(i.name)
                                                        % normalAF(c)
                                                        % tumorAF(c)
@@ -706,8 +684,7 @@ static void writeDetected(const FileName &file,
             auto sID = (i.var && i.alt && i.ref ? i.var->name : "-");
             const auto ctx = sID != "-" ?  ctx2Str(r.findSeqVar1(i.var->key()).ctx) : "-";
             
-            #define _FI_(x) (i.qry.fi.count(x) ? toString(i.qry.fi.at(x)) : "-")
-            #define _FF_(x) (i.qry.ff.count(x) ? toString(i.qry.ff.at(x)) : "-")
+            #define _FI_(f, s) (i.qry.hasFormat(f, s) ? toString(static_cast<int>(i.qry.format(f, s))) : "-")
             
             const auto key = i.var && i.alt && i.ref ? i.var->key() : i.qry.key();
             
@@ -719,8 +696,8 @@ static void writeDetected(const FileName &file,
                                                    % normalDPV(i.qry)
                                                    % tumorDPR(i.qry)
                                                    % tumorDPV(i.qry)
-                                                   % _FI_("DP_1")
-                                                   % _FI_("DP_2")
+                                                   % _FI_(VCFFormat::DP, 0)
+                                                   % _FI_(VCFFormat::DP, 1)
                                                    % (sID != "-" ? std::to_string(r.af(sID)) : "-")
                                                    % normalAF(i.qry)
                                                    % tumorAF(i.qry)
@@ -877,7 +854,7 @@ template <typename T, typename O> void writeFN(const FileName &file, const T &x,
         {
             wFN.write(x.hdr, x.line);
         }
-    });
+    }, ParserVCF::Fields());
     
     wFN.close();
 }
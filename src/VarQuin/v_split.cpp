@@ -1,6 +1,7 @@
-#include <fstream>
-#include <sstream>
+#include <memory>
+#include <cstring>
 #include <htslib/sam.h>
+#include <htslib/thread_pool.h>
 #include <htslib/vcf.h>
 #include "VarQuin.hpp"
 #include "VarQuin/v_split.hpp"
@@ -8,166 +9,276 @@
 
 using namespace Anaquin;
 
+// Defined in main.cpp
+extern unsigned __threads__;
+
+/*
+ * Contigs on the reverse genome, classified once from the header
+ */
+
+struct RevContigs
+{
+    RevContigs(const bam_hdr_t *h) : rev(h->n_targets)
+    {
+        for (auto i = 0; i < h->n_targets; i++)
+        {
+            rev[i] = isRevChr(h->target_name[i]);
+        }
+    }
+    
+    inline bool operator()(int32_t tid) const { return tid >= 0 && rev[tid]; }
+    
+    std::vector<bool> rev;
+};
+
+// Whether the supplementary or alternative alignments refer to the reverse genome
+static bool hasRevAux(const bam1_t *b)
+{
+    for (const auto tag : { "SA", "XA" })
+    {
+        const auto aux = bam_aux_get(b, tag);
+        
+        if (aux && *aux == 'Z' && strstr(bam_aux2Z(aux), "chrev"))
+        {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
 struct BAMWriter
 {
     inline void close()
     {
         sam_close(_file);
-        sam_close(_null);
+        
+        if (_filtered)
+        {
+            bam_hdr_destroy(_filtered);
+        }
+        
+        if (_scratch)
+        {
+            bam_destroy1(_scratch);
+        }
     }
     
-    inline void open(const FileName &file)
+    inline void open(const FileName &file, htsThreadPool *pool)
     {
-        _file = sam_open(file.c_str(), "wb");
-        _null = sam_open("/dev/null", "w");
+        if (!(_file = sam_open(file.c_str(), "wb")))
+        {
+            throw std::runtime_error("Failed to open: " + file);
+        }
+        
+        // Compression shared with the other writers
+        if (pool->pool)
+        {
+            hts_set_opt(_file, HTS_OPT_THREAD_POOL, pool);
+        }
     }
 
-    template <typename F> void filterH(const ParserBAM::Data &x, F f)
+    /*
+     * Write the header without the reverse genome. Chromosome indexes of the alignments are mapped
+     * to the filtered header.
+     */
+    
+    inline void fHeader(const bam_hdr_t *h)
     {
-        const auto *h1 = reinterpret_cast<bam_hdr_t *>(x.h());
-        const auto x1  = std::string(h1->text);
-        
-        std::stringstream ss;
-        std::istringstream iss(x1);
+        std::string text;
         
-        for (std::string line; std::getline(iss, line); )
+        for (const char *i = h->text, *end = h->text + h->l_text; i < end && *i; )
         {
-            if (f(line))
+            const auto *j = static_cast<const char *>(memchr(i, '\n', end - i));
+            const auto n = (j ? j + 1 : end) - i;
+            const auto line = std::string(i, n);
+            
+            if (line.find("chrev") == std::string::npos)
             {
-                ss << line << "\n";
+                text += line;
             }
+            
+            i += n;
         }
         
-        std::ofstream w;
-        w.open ("__tmp__.sam");
-        w << ss.str();
-        w.close();
+        if (!(_filtered = sam_hdr_init()) || sam_hdr_add_lines(_filtered, text.c_str(), text.size()) < 0)
+        {
+            throw std::runtime_error("Failed to filter header");
+        }
         
-        samFile *x2 = sam_open("__tmp__.sam", "r");
-        bam_hdr_t * h2 = sam_hdr_read(x2);
+        _tids.resize(h->n_targets);
+        _scratch = bam_init1();
         
-        if (sam_hdr_write(_file, h2) == -1)
+        for (auto i = 0; i < h->n_targets; i++)
         {
-            throw std::runtime_error("sam_hdr_write failed");
+            _tids[i] = bam_name2id(_filtered, h->target_name[i]);
         }
         
-        system("rm __tmp__.sam");
-    }
-    
-    inline void fHeader(const ParserBAM::Data &x)
-    {
-        return filterH(x, [&](const std::string &x)
-        {
-            return x.find("chrev") == std::string::npos;
-        });
+        header(_filtered);
     }
 
-    inline void header(const ParserBAM::Data &x)
+    inline void header(const bam_hdr_t *h)
     {
-        if (sam_hdr_write(_file, reinterpret_cast<bam_hdr_t *>(x.h())) == -1)
+        _h = h;
+        
+        if (sam_hdr_write(_file, h) == -1)
         {
             throw std::runtime_error("sam_hdr_write failed");
         }
     }
     
-    inline const char *record(const ParserBAM::Data &x)
+    // The alignment is shared with the other consumers (eg: VarFlip), it's never modified
+    inline void write(const bam1_t *b)
     {
-        const auto *b = reinterpret_cast<bam1_t *>(x.b());
-        const auto *h = reinterpret_cast<bam_hdr_t *>(x.h());
+        if (!_filtered)
+        {
+            if (sam_write1(_file, _h, b) == -1)
+            {
+                throw std::runtime_error("sam_write1 failed");
+            }
+            
+            return;
+        }
         
-        if (sam_write1(_null, h, b) == -1)
+        // Mapped into a copy owned by the writer
+        if (!bam_copy1(_scratch, b))
         {
-            throw std::runtime_error("sam_write1 failed");
+            throw std::runtime_error("bam_copy1 failed");
         }
         
-        return _null->line.s;
-    }
-    
-    inline void write(const ParserBAM::Data &x)
-    {
-        const auto *b = reinterpret_cast<bam1_t *>(x.b());
-        const auto *h = reinterpret_cast<bam_hdr_t *>(x.h());
+        _scratch->core.tid  = b->core.tid  >= 0 ? _tids[b->core.tid]  : -1;
+        _scratch->core.mtid = b->core.mtid >= 0 ? _tids[b->core.mtid] : -1;
         
-        if (sam_write1(_file, h, b) == -1)
+        if (sam_write1(_file, _h, _scratch) == -1)
         {
             throw std::runtime_error("sam_write1 failed");
         }
     }
     
-    samFile *_file, *_null;
+    samFile *_file = nullptr;
+    
+    // Header for the alignments written
+    const bam_hdr_t *_h = nullptr;
+    
+    // Header without the reverse genome (only if filtered)
+    bam_hdr_t *_filtered = nullptr;
+    
+    // Chromosome indexes in the filtered header
+    std::vector<int32_t> _tids;
+    
+    // Alignment mapped to the filtered header (only if filtered)
+    bam1_t *_scratch = nullptr;
 };
 
-void VSplit::report(const FileName &file, const Options &o)
+struct VSplit::Splitter::Impl
 {
-    const auto &r = Standard::instance().r_var;
-
-    o.info("Generating sample-derived alignments");
-    o.info("Generating sequin-derived alignments");
-    o.info("Generating sample-derived alignments within sequin regions");
-    
-    BAMWriter w1, w2, w3;
-    w1.open(o.work + "/VarFlip_sample.bam");
-    w2.open(o.work + "/VarFlip_sample_regions.bam");
-    w3.open(o.work + "/VarFlip_sequins.bam");
-
-    const auto regs = r.regs1();
-    
-    ParserBAM::parse(file, [&](ParserBAM::Data &x, const ParserBAM::Info &i)
+    Impl(const Options &o) : regs(ParserBAM::index(Standard::instance().r_var.regs1()))
     {
-        if (i.p.i && !(i.p.i % 1000000))
+        o.info("Generating sample-derived alignments");
+        o.info("Generating sequin-derived alignments");
+        o.info("Generating sample-derived alignments within sequin regions");
+        
+        if (__threads__ > 1 && !(pool.pool = hts_tpool_init(__threads__)))
         {
-            o.wait(std::to_string(i.p.i));
+            throw std::runtime_error("Failed to create thread pool");
         }
         
-        static bool header = false;
+        w1.open(o.work + "/VarFlip_sample.bam", &pool);
+        w2.open(o.work + "/VarFlip_sample_regions.bam", &pool);
+        w3.open(o.work + "/VarFlip_sequins.bam", &pool);
+    }
+    
+    // Compression for all writers
+    htsThreadPool pool = { nullptr, 0 };
+    
+    BAMWriter w1, w2, w3;
+    
+    ParserBAM::ChrIndex<const Chr2DInters> regs;
+    
+    std::shared_ptr<RevContigs> rev;
+};
 
-        if (!header)
-        {
-            w3.header(x);
-            w1.fHeader(x);
-            w2.fHeader(x);
-        }
+VSplit::Splitter::Splitter(const Options &o) : _impl(std::make_shared<Impl>(o)) {}
 
-        header = true;
+void VSplit::Splitter::operator()(ParserBAM::Data &x, const ParserBAM::Info &)
+{
+    auto &m = *_impl;
+    const auto *b = reinterpret_cast<const bam1_t *>(x.b());
+    
+    if (!m.rev)
+    {
+        const auto *h = reinterpret_cast<bam_hdr_t *>(x.h());
+        
+        m.rev = std::make_shared<RevContigs>(h);
+        m.w3.header(h);
+        m.w1.fHeader(h);
+        m.w2.fHeader(h);
+    }
+    
+    const auto &rev = *m.rev;
+    
+    /*
+     * ******************** Sample derived reads ********************
+     *
+     *   Eg: samtools view -h -L hg38.bed A.bam | grep -v chrev | samtools view -bS > VarFlip_sample.bam
+     */
+    
+    if (x.tid >= 0 && !rev(x.tid) && !rev(b->core.mtid) && !hasRevAux(b))
+    {
+        m.w1.write(b);
         
         /*
-         * ******************** Sample derived reads ********************
+         * ******************** Sample derived regional reads ********************
          *
-         *   Eg: samtools view -h -L hg38.bed A.bam | grep -v chrev | samtools view -bS > VarFlip_sample.bam
+         *   Eg: samtools view -b -h -L sequin_regions.hg38.bed sample_normal.bam > sample_normal_regions.bam
          */
         
-        if (x.cID != "*" && !isRevChr(x.cID) && !isRevChr(x.rnext))
+        const auto inters = m.regs.find(x);
+        
+        if (inters && inters->contains(x.l))
         {
-            if (!strstr(w1.record(x), "chrev"))
-            {
-                w1.write(x);
-                
-                /*
-                 * ******************** Sample derived regional reads ********************
-                 *
-                 *   Eg: samtools view -b -h -L sequin_regions.hg38.bed sample_normal.bam > sample_normal_regions.bam
-                 */
-                
-                if (regs.count(x.cID) && regs.at(x.cID).contains(x.l))
-                {
-                    w2.write(x);
-                }
-            }
+            m.w2.write(b);
         }
-        
-        /*
-         * ******************** Sequin derived reads ********************
-         *
-         *   Eg: samtools view -b -L hg38rev.bed normal.bam > sequins.bam
-         */
-        
-        if (isRevChr(x.cID))
+    }
+    
+    /*
+     * ******************** Sequin derived reads ********************
+     *
+     *   Eg: samtools view -b -L hg38rev.bed normal.bam > sequins.bam
+     */
+    
+    if (rev(x.tid))
+    {
+        m.w3.write(b);
+    }
+}
+
+void VSplit::Splitter::close()
+{
+    _impl->w1.close();
+    _impl->w2.close();
+    _impl->w3.close();
+    
+    if (_impl->pool.pool)
+    {
+        hts_tpool_destroy(_impl->pool.pool);
+        _impl->pool.pool = nullptr;
+    }
+}
+
+void VSplit::report(const FileName &file, const Options &o)
+{
+    Splitter split(o);
+    
+    ParserBAM::parse(file, [&](ParserBAM::Data &x, const ParserBAM::Info &i)
+    {
+        if (i.p.i && !(i.p.i % 1000000))
         {
-            w3.write(x);
-        }        
-    }, true);
+            o.wait(std::to_string(i.p.i));
+        }
+        
+        split(x, i);
+    });
 
-    w1.close();
-    w2.close();
-    w3.close();
+    split.close();
 }
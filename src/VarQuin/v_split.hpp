@@ -1,7 +1,9 @@
 #ifndef V_SPLIT_HPP
 #define V_SPLIT_HPP
 
+#include <memory>
 #include "stats/analyzer.hpp"
+#include "parsers/parser_bam.hpp"
 
 namespace Anaquin
 {
@@ -9,6 +11,28 @@ namespace Anaquin
     {
         typedef AnalyzerOptions Options;
 
+        /*
+         * Split the alignments as they are parsed, thus the parsing can be shared with other tools
+         * reading the same file. Output files are completed by close().
+         */
+        
+        class Splitter
+        {
+            public:
+            
+                Splitter(const Options &);
+            
+                void operator()(ParserBAM::Data &, const ParserBAM::Info &);
+            
+                void close();
+            
+            private:
+            
+                struct Impl;
+            
+                std::shared_ptr<Impl> _impl;
+        };
+        
         static void report(const FileName &, const Options &);
     };
 }
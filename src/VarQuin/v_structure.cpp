@@ -14,17 +14,17 @@ VStructure::EStats VStructure::analyzeE(const FileName &file, const Options &o)
     stats.v2c[Variation::Insertion];
     stats.v2c[Variation::Duplication];
     
-    const auto r1 = Standard::instance().r_var.regs1();
+    const auto &r1 = Standard::instance().r_var.regs1();
     
     if (!file.empty())
     {
-        ParserVCF::parse(file, [&](const Variant &x)
+        const auto indexed = ParserVCF::parseRegions(file, r1, [&](const Variant &x)
         {
             if (o.meth == VStructure::Method::Passed && x.filter != Filter::Pass)
             {
                 return;
             }
-            else if (!x.ifi.count("SVLEN"))
+            else if (!x.hasInfo(VCFInfo::SVLEN))
             {
                 return;
             }
@@ -32,7 +32,12 @@ VStructure::EStats VStructure::analyzeE(const FileName &file, const Options &o)
             {
                 stats.v2c[x.type()]++;
             }
-        });
+        }, ParserVCF::Fields({ VCFInfo::SVLEN }));
+        
+        if (!indexed)
+        {
+            o.logInfo("No index found for " + file + ". Parsing all variants.");
+        }
     }
     
     return stats;
@@ -62,7 +67,7 @@ VStructure::SStats VStructure::analyzeS(const FileName &file, const Options &o)
         {
             return;
         }
-        else if (!x.ifi.count("SVLEN"))
+        else if (!x.hasInfo(VCFInfo::SVLEN))
         {
             return;
         }
@@ -81,28 +86,6 @@ VStructure::SStats VStructure::analyzeS(const FileName &file, const Options &o)
             {
                 m.rID = m.var->name;
             }
-            else
-            {
-                MergedIntervals<> inters;
-                
-                try
-                {
-                    // We should to search where the FPs are
-                    inters = r.mInters(x.cID);
-                    
-                    A_ASSERT(inters.size());
-                    
-                    const auto m2 = inters.contains(x.l);
-                    
-                    // Can we find the corresponding region for the FP?
-                    if (m2)
-                    {
-                        m.rID = m2->id();
-                        A_ASSERT(!m.rID.empty());
-                    }
-                }
-                catch (...) {}
-            }
             
             return m;
         };
@@ -117,7 +100,10 @@ VStructure::SStats VStructure::analyzeS(const FileName &file, const Options &o)
         {
             stats.fps.push_back(m);
         }
-    });
+    }, ParserVCF::Fields({ VCFInfo::SVLEN }));
+    
+    // Which regions are the FPs in?
+    attributeFPs(r, stats.fps);
     
     /*
      * Determining the classification performance
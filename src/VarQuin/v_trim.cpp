@@ -1,7 +1,7 @@
 #include "tools/tools.hpp"
+#include "VarQuin/VarQuin.hpp"
 #include "VarQuin/v_trim.hpp"
 #include "writers/bam_writer.hpp"
-//#include "writers/sam_writer.hpp"
 #include "parsers/parser_bambed.hpp"
 
 extern Anaquin::FileName BedRef();
@@ -16,23 +16,20 @@ VTrim::Stats VTrim::analyze(const FileName &file, const Options &o)
     VTrim::Stats stats;
     
     // Regions without edge effects
-    const auto regs = r.regs1();
+    const auto &regs = r.regs1();
 
     const auto shouldL = o.meth == Method::Left  || o.meth == Method::LeftRight;
     const auto shouldR = o.meth == Method::Right || o.meth == Method::LeftRight;
     
     std::vector<DInter *> multi;
     
-    // Check trimming reads...
-    ParserBAMBED::parse(file, regs, [&](ParserBAM::Data &x, const ParserBAM::Info &info, const DInter *inter)
+    // Check whether the read should be trimmed
+    auto check = [&](const ParserBAM::Data &x, std::uint64_t k, ParserBAM::ChrIndex<const Chr2DInters> &index)
     {
-        if (info.p.i && !(info.p.i % 1000000))
-        {
-            o.logWait(std::to_string(info.p.i));
-        }
-
         multi.clear();
-        const auto m = x.mapped && regs.count(x.cID) ? regs.at(x.cID).contains(x.l, &multi) : nullptr;
+        
+        const auto i = x.mapped ? index.find(x) : nullptr;
+        const auto m = i ? i->contains(x.l, &multi) : nullptr;
         
         if (m)
         {
@@ -47,39 +44,61 @@ VTrim::Stats VTrim::analyze(const FileName &file, const Options &o)
             const auto lTrim = std::abs(x.l.start - m->l().start) <= o.trim;
             const auto rTrim = std::abs(x.l.end - m->l().end) <= o.trim;
             
-            if (shouldL && lTrim) { stats.lTrim.insert(x.name); }
-            if (shouldR && rTrim) { stats.rTrim.insert(x.name); }
+            if (shouldL && lTrim) { stats.lTrim.insert(k); }
+            if (shouldR && rTrim) { stats.rTrim.insert(k); }
         }
-
-        stats.before++;
-        return ParserBAMBED::Response::OK;
-    });
+    };
     
-    stats.left  = stats.lTrim.size();
-    stats.right = stats.rTrim.size();
+    auto isTrimmed = [&](std::uint64_t k)
+    {
+        return stats.lTrim.count(k) || stats.rTrim.count(k);
+    };
     
-    //SAMWriter w;
-    //w.open("");
     BAMWriter w;
     w.open(o.work + "/VarTrim_trimmed.bam");
     
+    /*
+     * Only alignments inside the sequin regions can be trimmed. With an index, only they are read
+     * for checking and the alignments are then written in a single pass. Otherwise (eg: unsorted),
+     * the whole file is parsed twice.
+     */
+    
+    auto index = ParserBAM::index(regs);
+    
+    // Check trimming reads...
+    if (!ParserBAM::parseRegions(file, regs, [&](ParserBAM::Data &x, const ParserBAM::Info &info)
+    {
+        if (info.p.i && !(info.p.i % 1000000))
+        {
+            o.logWait(std::to_string(info.p.i));
+        }
+        
+        check(x, hashName(x.name), index);
+    }))
+    {
+        o.logInfo(file + " is not indexed, parsing it twice");
+    }
+    
     // Triming away the paired reads ...
-    ParserBAMBED::parse(file, regs, [&](ParserBAM::Data &x, const ParserBAM::Info &info, const DInter *inter)
+    ParserBAM::parse(file, [&](ParserBAM::Data &x, const ParserBAM::Info &info)
     {
         if (info.p.i && !(info.p.i % 1000000))
         {
             o.logWait(std::to_string(info.p.i));
         }
-
-        if (!stats.lTrim.count(x.name) && !stats.rTrim.count(x.name))
+        
+        stats.before++;
+        
+        if (!isTrimmed(hashName(x.name)))
         {
             stats.after++;
             w.write(x);
         }
-        
-        return ParserBAMBED::Response::OK;
     });
     
+    stats.left  = stats.lTrim.size();
+    stats.right = stats.rTrim.size();
+    
     stats.nRegs = countMap(regs, [&](ChrID, const DIntervals<> &x)
     {
         return x.size();
@@ -1,6 +1,7 @@
 #ifndef V_TRIM_HPP
 #define V_TRIM_HPP
 
+#include <unordered_set>
 #include "stats/analyzer.hpp"
 
 namespace Anaquin
@@ -31,8 +32,8 @@ namespace Anaquin
             // Number of reference regions
             Counts nRegs;
             
-            // Reads trimmed on left and right
-            std::set<ReadName> lTrim, rTrim;
+            // Reads trimmed on left and right (64-bit hashes of the read names)
+            std::unordered_set<std::uint64_t> lTrim, rTrim;
         };
 
         struct Options : public AnalyzerOptions
@@ -128,7 +128,8 @@ GStr::GStr(const char *s): my_data(&null_data) {
   readbuf=NULL;
   readbufsize=0;
   my_data=new_data(s);
-  my_data->ref_count = 1;
+  //null_data is shared by all threads, never written
+  if (my_data != &null_data) my_data->ref_count = 1;
  }
 
 GStr::GStr(const int i): my_data(&null_data) {
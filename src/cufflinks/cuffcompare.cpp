@@ -55,34 +55,37 @@ Options:\n\
 -T do not generate .tmap and .refmap files for each input file\n\
 -V verbose processing mode (showing all GFF parsing warnings)\n\
 "
-bool debug=false;
-bool perContigStats=false; // -S to enable stats for every single contig
+//-- the engine keeps its state for each thread (no process-wide globals), so that
+//   comparisons can run concurrently on separate threads. The results are written
+//   to the Anaquin::Compare given to cuffcompare_main()
+thread_local bool debug=false;
+thread_local bool perContigStats=false; // -S to enable stats for every single contig
 //bool generic_GFF=false;
 //true if -G: won't discard intron-redundant transfrags
 
-bool showContained=false; // -C
-bool reduceRefs=false; //-R
-bool reduceQrys=false; //-Q
-bool checkFasta=false;
-bool tmapFiles=true;
-bool only_spliced_refs=false;
-int debugCounter=0;
-
-int polyrun_range=2000; //polymerase run range 2KB
-double scoreThreshold=0;
-char* cprefix=NULL;
-FILE* ffasta=NULL; //genomic seq file
-FILE *f_ref=NULL; //reference mRNA GFF, if provided
-FILE* f_in=NULL; //sequentially, each input GFF file
-FILE* f_out=NULL; //stdout if not provided
-GFastaHandler gfasta;
-int xlocnum=0;
-int tsscl_num=0; //for tss cluster IDs
-int protcl_num=0; //for "unique" protein IDs within TSS clusters
-int tssDist=100;
-uint exonEndRange=100; // -e value, only used for exon level Sn/Sp
+thread_local bool showContained=false; // -C
+thread_local bool reduceRefs=false; //-R
+thread_local bool reduceQrys=false; //-Q
+thread_local bool checkFasta=false;
+thread_local bool tmapFiles=true;
+thread_local bool only_spliced_refs=false;
+thread_local int debugCounter=0;
+
+thread_local int polyrun_range=2000; //polymerase run range 2KB
+thread_local double scoreThreshold=0;
+thread_local char* cprefix=NULL;
+thread_local FILE* ffasta=NULL; //genomic seq file
+thread_local FILE *f_ref=NULL; //reference mRNA GFF, if provided
+thread_local FILE* f_in=NULL; //sequentially, each input GFF file
+thread_local FILE* f_out=NULL; //stdout if not provided
+thread_local GFastaHandler gfasta;
+thread_local int xlocnum=0;
+thread_local int tsscl_num=0; //for tss cluster IDs
+thread_local int protcl_num=0; //for "unique" protein IDs within TSS clusters
+thread_local int tssDist=100;
+thread_local uint exonEndRange=100; // -e value, only used for exon level Sn/Sp
 //int total_tcons=0;
-int total_xloci_alt=0;
+thread_local int total_xloci_alt=0;
 
 void openfwrite(FILE* &f, GArgs& args, char opt) {
   GStr s=args.getOpt(opt);
@@ -130,14 +133,14 @@ class GSeqTrack {
 //char* getFastaFile(int gseq_id);
 
 // ref globals
-bool haveRefs=false;  //true if a reference annotation (-r) is provide
+thread_local bool haveRefs=false;  //true if a reference annotation (-r) is provide
 
-GList<GSeqData> ref_data(true,true,true); //list of reference mRNAs and loci data for each genomic seq
+thread_local GList<GSeqData> ref_data(true,true,true); //list of reference mRNAs and loci data for each genomic seq
               //each locus will keep track of any superloci which includes it, formed during the analysis
 
 void processLoci(GSeqData& seqdata, GSeqData* refdata=NULL, int qfidx=0);
 
-void reportStats(FILE* fout, const char* setname, GSuperLocus& stotal,
+void reportStats(Anaquin::Compare& cmp, FILE* fout, const char* setname, GSuperLocus& stotal,
        GSeqData* seqdata=NULL, GSeqData* refdata=NULL);
 
 GSeqData* getQryData(int gid, GList<GSeqData>& qdata);
@@ -146,18 +149,18 @@ void trackGData(int qcount, GList<GSeqTrack>& gtracks, GStr& fbasename, FILE** f
 #define FWCLOSE(fh) if (fh!=NULL && fh!=stdout) fclose(fh)
 #define FRCLOSE(fh) if (fh!=NULL && fh!=stdin) fclose(fh)
 
-FILE* f_mintr=NULL; //missed ref introns
+thread_local FILE* f_mintr=NULL; //missed ref introns
 
-bool multiexon_only=false;
-bool multiexonrefs_only=false;
+thread_local bool multiexon_only=false;
+thread_local bool multiexonrefs_only=false;
 
-GHash<GStr> refdescr;
+thread_local GHash<GStr> refdescr;
 void loadRefDescr(const char* fname);
 
-GList<GStr> qryfiles(false,true,false);
+thread_local GList<GStr> qryfiles(false,true,false);
 
 //list of GSeqTrack data, sorted by gseq_id
-GList<GSeqTrack> gseqtracks(true,true,true);
+thread_local GList<GSeqTrack> gseqtracks(true,true,true);
 GSeqTrack* findGSeqTrack(int gsid);
 
 
@@ -172,10 +175,7 @@ void show_usage() {
   GMessage("%s\n", USAGE);
   }
 
-// Defined in r_assembly.cpp
-extern Anaquin::Compare __cmp__;
-
-int cuffcompare_main(const char *ref, const char *query) {
+int cuffcompare_main(const char *ref, const char *query, Anaquin::Compare &cmp) {
 
     char * argv[4];
     
@@ -191,6 +191,16 @@ int cuffcompare_main(const char *ref, const char *query) {
 
     int argc = 4;
 
+  //-- reset the state left by an earlier comparison on this thread
+  haveRefs=false;
+  xlocnum=0;
+  tsscl_num=0;
+  protcl_num=0;
+  total_xloci_alt=0;
+  GXConsensus::count=0;
+  f_mintr=NULL;
+  qryfiles.Clear();
+
 #ifdef HEAPROFILE
   if (!IsHeapProfilerRunning())
       HeapProfilerStart("./cuffcompare_dbg.hprof");
@@ -419,7 +429,7 @@ int cuffcompare_main(const char *ref, const char *query) {
         }
         seqtrack->qdata[fi]=pdata->Get(g);
         //will only gather data into stats if perContig==false
-        if (!gtf_tracking_largeScale) reportStats(f_out, getGSeqName(gsid), gstats,
+        if (!gtf_tracking_largeScale) reportStats(cmp, f_out, getGSeqName(gsid), gstats,
               pdata->Get(g), refdata);
         if (faseq!=NULL) delete faseq;
       } //for each genomic sequence data
@@ -430,12 +440,12 @@ int cuffcompare_main(const char *ref, const char *query) {
           GSeqData* refdata=ref_data[r];
           int gsid=refdata->get_gseqid();
           if (getQryData(gsid, *pdata)==NULL) {
-            reportStats(f_out, getGSeqName(gsid), gstats, NULL, refdata);
+            reportStats(cmp, f_out, getGSeqName(gsid), gstats, NULL, refdata);
             }//completely missed all refdata on this contig
         }
       }
       //now report the summary:
-      if (!gtf_tracking_largeScale) reportStats(f_out, in_file.chars(), gstats);
+      if (!gtf_tracking_largeScale) reportStats(cmp, f_out, in_file.chars(), gstats);
       if (f_in!=stdin) fclose(f_in);
       //qfileno++;
   }//for each input file
@@ -1441,7 +1451,7 @@ void collectStats(GSuperLocus& stats, GSeqData* seqdata, GSeqData* refdata) {
   }
 }
 
-void reportStats(FILE* fout_, const char* setname, GSuperLocus& stotal,
+void reportStats(Anaquin::Compare& cmp, FILE* fout_, const char* setname, GSuperLocus& stotal,
                           GSeqData* seqdata, GSeqData* refdata) {
   GSuperLocus stats;
   bool finalSummary=(seqdata==NULL && refdata==NULL);
@@ -1478,8 +1488,8 @@ void reportStats(FILE* fout_, const char* setname, GSuperLocus& stotal,
     double sn=(100.0*(double)ps->baseTP)/(ps->baseTP+ps->baseFN);
     
     //fprintf(fout, "        Base level: \t%5.1f\t%5.1f\t  - \t  - \n",sn, sp);
-    __cmp__.b_sp = sp;
-    __cmp__.b_sn = sn;
+    cmp.b_sp = sp;
+    cmp.b_sn = sn;
 
     sp=(100.0*(double)ps->exonTP)/(ps->exonTP+ps->exonFP);
     sn=(100.0*(double)ps->exonTP)/(ps->exonTP+ps->exonFN);
@@ -1489,10 +1499,10 @@ void reportStats(FILE* fout_, const char* setname, GSuperLocus& stotal,
     if (fsn>100.0) fsn=100.0;
     
 //    fprintf(fout, "        Exon level: \t%5.1f\t%5.1f\t%5.1f\t%5.1f\n",sn, sp, fsn, fsp);
-      __cmp__.e_sp = sp;
-      __cmp__.e_sn = sn;
-      __cmp__.e_fsp = fsp;
-      __cmp__.e_fsn = fsn;
+      cmp.e_sp = sp;
+      cmp.e_sn = sn;
+      cmp.e_fsp = fsp;
+      cmp.e_fsn = fsn;
 
     if (ps->total_rintrons>0) {
     //intron level
@@ -1504,10 +1514,10 @@ void reportStats(FILE* fout_, const char* setname, GSuperLocus& stotal,
     if (fsn>100.0) fsn=100.0;
     
         //fprintf(fout, "      Intron level: \t%5.1f\t%5.1f\t%5.1f\t%5.1f\n",sn, sp, fsn, fsp);
-        __cmp__.i_sp = sp;
-        __cmp__.i_sn = sn;
-        __cmp__.i_fsp = fsp;
-        __cmp__.i_fsn = fsn;
+        cmp.i_sp = sp;
+        cmp.i_sn = sn;
+        cmp.i_fsp = fsp;
+        cmp.i_fsn = fsn;
 
         //intron chains:
     sp=(100.0*(double)ps->ichainTP)/(ps->ichainTP+ps->ichainFP);
@@ -1520,10 +1530,10 @@ void reportStats(FILE* fout_, const char* setname, GSuperLocus& stotal,
     if (fsn>100.0) fsn=100.0;
     
         //fprintf(fout, "Intron chain level: \t%5.1f\t%5.1f\t%5.1f\t%5.1f\n",sn, sp, fsn, fsp);
-        __cmp__.c_sp = sp;
-        __cmp__.c_sn = sn;
-        __cmp__.c_fsp = fsp;
-        __cmp__.c_fsn = fsn;
+        cmp.c_sp = sp;
+        cmp.c_sn = sn;
+        cmp.c_fsp = fsp;
+        cmp.c_fsn = fsn;
 
     }
   else {
@@ -1539,10 +1549,10 @@ void reportStats(FILE* fout_, const char* setname, GSuperLocus& stotal,
     if (fsn>100.0) fsn=100.0;
     
       //fprintf(fout, "  Transcript level: \t%5.1f\t%5.1f\t%5.1f\t%5.1f\n",sn, sp, fsn, fsp);
-      __cmp__.t_sp = sp;
-      __cmp__.t_sn = sn;
-      __cmp__.t_fsp = fsp;
-      __cmp__.t_fsn = fsn;
+      cmp.t_sp = sp;
+      cmp.t_sn = sn;
+      cmp.t_fsp = fsp;
+      cmp.t_fsn = fsn;
 
       //sp=(100.0*(double)ps->locusTP)/(ps->locusTP+ps->locusFP);
     sp=(100.0*(double)ps->locusQTP)/ps->total_qloci;
@@ -1551,10 +1561,10 @@ void reportStats(FILE* fout_, const char* setname, GSuperLocus& stotal,
     fsn=(100.0*(double)ps->locusATP)/ps->total_rloci; //(ps->locusATP+ps->locusAFN);
     
       //fprintf(fout, "       Locus level: \t%5.1f\t%5.1f\t%5.1f\t%5.1f\n",sn, sp, fsn, fsp);
-      __cmp__.l_sp = sp;
-      __cmp__.l_sn = sn;
-      __cmp__.l_fsp = fsp;
-      __cmp__.l_fsn = fsn;
+      cmp.l_sp = sp;
+      cmp.l_sn = sn;
+      cmp.l_fsp = fsp;
+      cmp.l_fsn = fsn;
    
       //fprintf(fout, "                   (locus TP=%d, total ref loci=%d)\n",ps->locusTP, ps->total_rloci);
     //fprintf(fout,"\n     Matching intron chains: %7d\n",ps->ichainTP);
@@ -1563,30 +1573,30 @@ void reportStats(FILE* fout_, const char* setname, GSuperLocus& stotal,
     
       sn=(100.0*(double)ps->m_exons)/(ps->total_rexons);
       //fprintf(fout, "          Missed exons: %7d/%d\t(%5.1f%%)\n",ps->m_exons, ps->total_rexons, sn);
-      __cmp__.missedExonsN = ps->m_exons;
-      __cmp__.missedExonsR = ps->total_rexons;
-      __cmp__.missedExonsP = sn;
+      cmp.missedExonsN = ps->m_exons;
+      cmp.missedExonsR = ps->total_rexons;
+      cmp.missedExonsP = sn;
       
       sn=(100.0*(double)ps->w_exons)/(ps->total_qexons);
       //fprintf(fout, "           Novel exons: %7d/%d\t(%5.1f%%)\n",ps->w_exons, ps->total_qexons,sn);
-      __cmp__.novelExonsN = ps->w_exons;
-      __cmp__.novelExonsR = ps->total_qexons;
-      __cmp__.novelExonsP = sn;
+      cmp.novelExonsN = ps->w_exons;
+      cmp.novelExonsR = ps->total_qexons;
+      cmp.novelExonsP = sn;
       
       if (ps->total_rintrons>0) {
           sn=(100.0*(double)ps->m_introns)/(ps->total_rintrons);
           //fprintf(fout, "        Missed introns: %7d/%d\t(%5.1f%%)\n",ps->m_introns, ps->total_rintrons, sn);
-          __cmp__.missedIntronsN = ps->m_introns;
-          __cmp__.missedIntronsR = ps->total_rintrons;
-          __cmp__.missedIntronsP = sn;
+          cmp.missedIntronsN = ps->m_introns;
+          cmp.missedIntronsR = ps->total_rintrons;
+          cmp.missedIntronsP = sn;
       }
       
       if (ps->total_qintrons>0) {
         sn=(100.0*(double)ps->w_introns)/(ps->total_qintrons);
           //fprintf(fout, "         Novel introns: %7d/%d\t(%5.1f%%)\n",ps->w_introns, ps->total_qintrons,sn);
-          __cmp__.novelIntronsN = ps->w_introns;
-          __cmp__.novelIntronsR = ps->total_qintrons;
-          __cmp__.novelIntronsP = sn;
+          cmp.novelIntronsN = ps->w_introns;
+          cmp.novelIntronsR = ps->total_qintrons;
+          cmp.novelIntronsP = sn;
       }
       
     if (ps->total_rloci>0) {
@@ -1601,8 +1611,8 @@ void reportStats(FILE* fout_, const char* setname, GSuperLocus& stotal,
   }
 }
 
-int inbuf_len=1024; //starting inbuf capacity
-char* inbuf=NULL; // incoming buffer for sequence lines.
+thread_local int inbuf_len=1024; //starting inbuf capacity
+thread_local char* inbuf=NULL; // incoming buffer for sequence lines.
 
 void loadRefDescr(const char* fname) {
   if (inbuf==NULL)  { GMALLOC(inbuf, inbuf_len); }
@@ -1,13 +1,13 @@
 #include "gff.h"
 
-GffNames* GffObj::names=NULL;
+thread_local GffNames* GffObj::names=NULL;
 //global set of feature names, attribute names etc.
-// -- common for all GffObjs in current application!
+// -- common for all GffObjs in current thread (each comparison has its own names)
 
 const uint GFF_MAX_LOCUS = 7000000; //longest known gene in human is ~2.2M, UCSC claims a gene for mouse of ~ 3.1 M
 const uint GFF_MAX_EXON  =   30000; //longest known exon in human is ~11K
 const uint GFF_MAX_INTRON= 6000000; //Ensembl shows a >5MB human intron 
-bool gff_show_warnings = false; //global setting, set by GffReader->showWarnings()
+thread_local bool gff_show_warnings = false; //global setting, set by GffReader->showWarnings()
 const int gff_fid_mRNA=0;
 const int gff_fid_transcript=1;
 const int gff_fid_exon=2;
@@ -129,7 +129,7 @@ char* GffLine::extractAttr(const char* attr, bool caseStrict, bool enforce_GTF2)
  return r;
 }
 
-static char fnamelc[128];
+static thread_local char fnamelc[128];
 
 GffLine::GffLine(GffReader* reader, const char* l) {
  llen=strlen(l);
@@ -45,7 +45,7 @@ extern const uint gfo_flag_LST_KEEP; //GffObj from GffReader::gflst is to be kep
 extern const uint gfo_flag_LEVEL_MSK; //hierarchical level: 0 = no parent
 extern const byte gfo_flagShift_LEVEL;
 
-extern bool gff_show_warnings;
+extern thread_local bool gff_show_warnings;
 
 #define GFF_LINELEN 2048
 #define ERR_NULL_GFNAMES "Error: GffObj::%s requires a non-null GffNames* names!\n"
@@ -443,7 +443,7 @@ class GffObj:public GSeg {
    friend class GffReader;
    friend class GffExon;
 public:
-  static GffNames* names; // dictionary storage that holds the various attribute names etc.
+  static thread_local GffNames* names; // dictionary storage that holds the various attribute names etc.
   int track_id; // index of track name in names->tracks
   int gseq_id; // index of genomic sequence name in names->gseqs
   int ftype_id; // index of this record's feature name in names->feats, or the special gff_fid_mRNA value
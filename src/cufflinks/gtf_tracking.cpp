@@ -9,10 +9,10 @@
 
 #include "gtf_tracking.h"
 
-bool gtf_tracking_verbose = false;
-bool gtf_tracking_largeScale=false; //many input Cufflinks files processed at once by cuffcompare, discard exon attributes
+thread_local bool gtf_tracking_verbose = false;
+thread_local bool gtf_tracking_largeScale=false; //many input Cufflinks files processed at once by cuffcompare, discard exon attributes
 
-int GXConsensus::count=0;
+thread_local int GXConsensus::count=0;
 
 char* getGSeqName(int gseq_id) {
  return GffObj::names->gseqs.getName(gseq_id);
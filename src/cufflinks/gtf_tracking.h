@@ -16,9 +16,9 @@
 
 #define MAX_QFILES 500
 
-extern bool gtf_tracking_verbose;
+extern thread_local bool gtf_tracking_verbose;
 
-extern bool gtf_tracking_largeScale;
+extern thread_local bool gtf_tracking_largeScale;
 //many input files, no accuracy stats are generated, no *.tmap
 // and exon attributes are discarded
 
@@ -1075,7 +1075,7 @@ class GTrackLocus:public GSeg {
 
 class GXConsensus:public GSeg {
  public:
-   static int count;
+   static thread_local int count;
    int id; //XConsensus ID
    int tss_id; //group id for those xconsensi with shared first exon
    int p_id; //group id for those xconsensi with "similar" protein
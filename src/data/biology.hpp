@@ -43,23 +43,38 @@ namespace Anaquin
         Somatic
     };
     
+    /*
+     * Complement of every base (zero if not a base)
+     */
+    
+    struct ComplementTable
+    {
+        ComplementTable() : x()
+        {
+            x['A'] = 'T';
+            x['T'] = 'A';
+            x['G'] = 'C';
+            x['C'] = 'G';
+            x['N'] = 'N';
+        }
+        
+        char x[256];
+    };
+    
     /*
      * Complement DNA string
      */
     
     template <typename T> void complement(T &x)
     {
-        std::map<char, char> m = { { 'A', 'T' },
-                                   { 'T', 'A' },
-                                   { 'G', 'C' },
-                                   { 'C', 'G' },
-                                   { 'N', 'N' } };
-
-        std::transform(x.begin(), x.end(), x.begin(), [&](char c)
+        static const ComplementTable t;
+        
+        for (auto &c : x)
         {
-            A_ASSERT(m.count(c));
-            return m[c];
-        });
+            const auto r = t.x[static_cast<unsigned char>(c)];
+            A_ASSERT(r);
+            c = r;
+        }
     }
 
     /*
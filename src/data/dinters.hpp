@@ -2,9 +2,12 @@
 #define INTERVALS_HPP
 
 #include <map>
+#include <limits>
+#include <memory>
 #include <numeric>
 #include <ss/stats.hpp>
 #include "data/data.hpp"
+#include "data/hist.hpp"
 #include "data/itree.hpp"
 #include "data/locus.hpp"
 
@@ -34,7 +37,7 @@ namespace Anaquin
                 Counts aligns = 0;
                 
                 // Distribution for the coverage
-                std::map<Coverage, Counts> hist;
+                CoverageHist hist;
             
                 // Length of the interval
                 Base length = 0;
@@ -48,13 +51,13 @@ namespace Anaquin
                 inline Proportion covered() const { return static_cast<double>(nonZeros) / length; }
             };
         
-            DInter(const IntervalID &id, const Locus &l) : _id(id), _l(l)
-            {
-                _covs.resize(l.length());
-            }
+            // Coverage is allocated when the first alignment is mapped
+            DInter(const IntervalID &id, const Locus &l) : _id(id), _l(l) {}
 
             inline void add(const Locus &l)
             {
+                alloc();
+                
                 if (l.start < _covs.size()) { _covs[l.start].starts++; }
                 if (l.end < _covs.size())   { _covs[l.end].ends++;     }
                 else                        { _covs.back().ends++;     }
@@ -74,6 +77,7 @@ namespace Anaquin
             
                 if (start <= end)
                 {
+                    alloc();
                     _covs[start].starts++;
                     _covs[end].ends++;
                     assert(start < _covs.size() && end < _covs.size());
@@ -93,13 +97,23 @@ namespace Anaquin
                 return left + right;
             }
         
+            /*
+             * Compute the statistics and release the coverage. Nothing can be mapped to the interval
+             * afterwards, stats() returns the computed statistics.
+             */
+            
+            inline void finalize()
+            {
+                _stats = std::make_shared<Stats>(stats());
+                std::vector<Depth>().swap(_covs);
+            }
+        
+            inline bool finalized() const { return (bool) _stats; }
+        
             template <typename F> Stats stats(F f) const
             {
                 Stats stats;
                 
-                // Required for estimating percentile
-                std::vector<double> x;
-
                 bedGraph([&](const ChrID &id, Base i, Base j, Coverage cov)
                 {
                     // Should this be counted? For example, aligning to sequins?
@@ -114,25 +128,19 @@ namespace Anaquin
                     // The interval is half-open
                     const auto n = j - i;
                     
-                    stats.sums      += (n * cov);
-                    stats.length    += n;
-                    stats.hist[cov] += n;
-                    
-                    for (auto i = 0; i < n; i++)
-                    {
-                        x.push_back(cov);
-                    }
+                    stats.sums   += (n * cov);
+                    stats.length += n;
+                    stats.hist.add(cov, n);
                     
                     if (!cov) { stats.zeros    += n; }
                     else      { stats.nonZeros += n; }
                 });
             
-                std::sort(x.begin(), x.end());
-                
+                // Quantiles from the run lengths
                 stats.mean   = stats.sums / stats.length;
-                stats.p25    = SS::quantile(x, 0.25);
-                stats.p50    = SS::quantile(x, 0.50);
-                stats.p75    = SS::quantile(x, 0.75);
+                stats.p25    = stats.hist.quantile(0.25);
+                stats.p50    = stats.hist.quantile(0.50);
+                stats.p75    = stats.hist.quantile(0.75);
                 stats.aligns = count();
 
                 return stats;
@@ -140,6 +148,11 @@ namespace Anaquin
         
             inline Stats stats() const
             {
+                if (_stats)
+                {
+                    return *_stats;
+                }
+                
                 return stats([&](const ChrID &id, Base i, Base j, Coverage cov)
                 {
                     return true;
@@ -148,6 +161,18 @@ namespace Anaquin
         
             template <typename T> void bedGraph(T t) const
             {
+                if (_stats)
+                {
+                    throw std::runtime_error("Coverage for " + _id + " has been released");
+                }
+                
+                // Nothing mapped
+                if (_covs.empty())
+                {
+                    t(_id, 0, _l.length(), 0);
+                    return;
+                }
+                
                 Base depth = 0;
                 long lastStart = -1;
                 long lastDepth = -1;
@@ -194,6 +219,16 @@ namespace Anaquin
                 Base ends;
             };
         
+            inline void alloc()
+            {
+                assert(!_stats);
+                
+                if (_covs.empty())
+                {
+                    _covs.resize(_l.length());
+                }
+            }
+        
             // The represented interval
             Locus _l;
         
@@ -204,6 +239,9 @@ namespace Anaquin
 
             // For each base in the interval (relative to the beginning of the interval)
             std::vector<Depth> _covs;
+        
+            // Only after finalize()
+            std::shared_ptr<Stats> _stats;
     };
     
     template <typename T = DInter> class DIntervals
@@ -212,6 +250,32 @@ namespace Anaquin
         
             typedef std::map<typename T::IntervalID, T> IntervalData;
 
+            DIntervals() = default;
+            DIntervals(DIntervals &&) = default;
+            DIntervals &operator=(DIntervals &&) = default;
+        
+            // The tree holds pointers to the intervals, a copy must have its own tree
+            DIntervals(const DIntervals &x) : _inters(x._inters)
+            {
+                if (x._tree)
+                {
+                    build();
+                }
+            }
+        
+            inline DIntervals &operator=(const DIntervals &x)
+            {
+                _inters = x._inters;
+                _tree.reset();
+                
+                if (x._tree)
+                {
+                    build();
+                }
+                
+                return *this;
+            }
+
             inline void add(const T &i)
             {
                 _inters.insert(typename std::map<typename T::IntervalID, T>::value_type(i.id(), i));
@@ -233,7 +297,7 @@ namespace Anaquin
                     throw std::runtime_error("No interval was built. loci.empty().");
                 }
             
-                _tree = std::shared_ptr<IntervalTree<T *>>(new IntervalTree<T *> { loci });
+                _tree = std::shared_ptr<FlatIntervalTree<T *>>(new FlatIntervalTree<T *>(std::move(loci)));
             }
         
             inline T * find(const typename T::IntervalID &id)
@@ -248,11 +312,9 @@ namespace Anaquin
 
             inline T * exact(const Locus &l, std::vector<T *> *r = nullptr) const
             {
-                auto v = _tree->findContains(l.start, l.end);
-
                 T *t = nullptr;
     
-                for (const auto &i : v)
+                _tree->visitContains(l.start, l.end, [&](const Interval_<T *> &i)
                 {
                     if (i.value->l() == l)
                     {
@@ -263,41 +325,57 @@ namespace Anaquin
                             r->push_back(t);
                         }
                     }
-                }
+                    
+                    return true;
+                });
             
                 return t;
             }
         
             inline T * contains(const Locus &l, std::vector<T *> *r = nullptr) const
             {
-                auto v = _tree->findContains(l.start, l.end);
-
-                if (r)
+                T *t = nullptr;
+                
+                // Stop at the first match unless everything is needed
+                _tree->visitContains(l.start, l.end, [&](const Interval_<T *> &i)
                 {
-                    for (const auto &i : v)
+                    if (!t)
+                    {
+                        t = i.value;
+                    }
+                    
+                    if (r)
                     {
-                        if (i.value)
-                        
                         r->push_back(i.value);
                     }
-                }
+                    
+                    return r != nullptr;
+                });
             
-                return v.empty() ? nullptr : v.front().value;
+                return t;
             }
         
             inline T * overlap(const Locus &l, std::vector<T *> *r = nullptr) const
             {
-                auto v = _tree->findOverlapping(l.start, l.end);
-            
-                if (r)
+                T *t = nullptr;
+                
+                // Stop at the first match unless everything is needed
+                _tree->visitOverlapping(l.start, l.end, [&](const Interval_<T *> &i)
                 {
-                    for (const auto &i : v)
+                    if (!t)
+                    {
+                        t = i.value;
+                    }
+                    
+                    if (r)
                     {
                         r->push_back(i.value);
                     }
-                }
+                    
+                    return r != nullptr;
+                });
             
-                return v.empty() ? nullptr : v.front().value;
+                return t;
             }
 
             template <typename F> void bedGraph(F f) const
@@ -327,10 +405,7 @@ namespace Anaquin
                     stats.min       = std::min(stats.min, s.min);
                     stats.max       = std::max(stats.max, s.max);
                 
-                    for (const auto &j : s.hist)
-                    {
-                        stats.hist[j.first] += j.second;
-                    }
+                    stats.hist.add(s.hist);
                 }
             
                 stats.mean = stats.sums / stats.length;
@@ -354,7 +429,7 @@ namespace Anaquin
         
         private:
         
-            std::shared_ptr<IntervalTree<T *>> _tree;
+            std::shared_ptr<FlatIntervalTree<T *>> _tree;
         
             IntervalData _inters;
     };
@@ -417,28 +492,13 @@ namespace Anaquin
                 stats.min       = std::min(stats.min, s.min);
                 stats.max       = std::max(stats.max, s.max);
                 
-                for (const auto &j : s.hist)
-                {
-                    stats.hist[j.first] += j.second;
-                }
+                stats.hist.add(s.hist);
             }
             
             auto percent = [&](Counts n)
             {
-                Counts i = 0;
-                
-                for (const auto &p : stats.hist)
-                {
-                    i += p.second;
-                    
-                    // Have we reached our percentile?
-                    if (i >= n)
-                    {
-                        return p.first;
-                    }
-                }
-                
-                return stats.max;
+                const auto r = stats.hist.percent(n);
+                return std::isnan(r) ? stats.max : r;
             };
             
             stats.mean = stats.sums / stats.length;
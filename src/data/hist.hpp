@@ -3,7 +3,9 @@
 
 #include <set>
 #include <map>
+#include <cmath>
 #include <string>
+#include <vector>
 #include <assert.h>
 #include "data/data.hpp"
 
@@ -26,6 +28,151 @@ namespace Anaquin
         return hist;
     }
     
+    /*
+     * Distribution of per-base coverage. Small integral coverage is counted in a flat array and
+     * anything else in a sparse map. Quantiles are computed from the counts, there is no need to
+     * keep a value for each base.
+     */
+    
+    class CoverageHist
+    {
+        public:
+        
+            // Largest coverage counted in the flat array
+            static const Base Dense = 1023;
+        
+            inline void add(Coverage x, Counts n)
+            {
+                if (!n)
+                {
+                    return;
+                }
+                
+                if (x >= 0 && x <= Dense && x == std::floor(x))
+                {
+                    const auto i = static_cast<std::size_t>(x);
+                    
+                    if (i >= _dense.size())
+                    {
+                        _dense.resize(i + 1);
+                    }
+                    
+                    _dense[i] += n;
+                }
+                else
+                {
+                    _sparse[x] += n;
+                }
+                
+                _n += n;
+            }
+        
+            inline void add(const CoverageHist &x)
+            {
+                x.each([&](Coverage c, Counts n)
+                {
+                    add(c, n);
+                });
+            }
+        
+            // Number of bases
+            inline Counts size() const { return _n; }
+        
+            // Visit the coverage in ascending order
+            template <typename F> void each(F f) const
+            {
+                auto i = _sparse.begin();
+                
+                // Negative coverage comes first (shouldn't happen)
+                for (; i != _sparse.end() && i->first < 0; i++)
+                {
+                    f(i->first, i->second);
+                }
+                
+                for (auto j = 0u; j < _dense.size(); j++)
+                {
+                    // Non-integral coverage in between
+                    for (; i != _sparse.end() && i->first < j; i++)
+                    {
+                        f(i->first, i->second);
+                    }
+                    
+                    if (_dense[j])
+                    {
+                        f(j, _dense[j]);
+                    }
+                }
+                
+                for (; i != _sparse.end(); i++)
+                {
+                    f(i->first, i->second);
+                }
+            }
+        
+            // The k-th smallest coverage (zero-based)
+            inline Coverage kth(Counts k) const
+            {
+                assert(k < _n);
+                
+                Counts i = 0;
+                Coverage r = NAN;
+                
+                each([&](Coverage c, Counts n)
+                {
+                    if (std::isnan(r) && (i += n) > k)
+                    {
+                        r = c;
+                    }
+                });
+                
+                return r;
+            }
+        
+            // Same as SS::quantile on the sorted coverage
+            inline Coverage quantile(Proportion p) const
+            {
+                if (!_n)
+                {
+                    return NAN;
+                }
+                
+                const auto id = (_n - 1) * p;
+                const auto lo = std::floor(id);
+                const auto hi = std::ceil(id);
+                const auto h  = id - lo;
+                
+                return (1.0 - h) * kth(lo) + h * kth(hi);
+            }
+        
+            // The smallest coverage with at least n bases at or below it
+            inline Coverage percent(Counts n) const
+            {
+                Counts i = 0;
+                Coverage r = NAN;
+                
+                each([&](Coverage c, Counts m)
+                {
+                    if (std::isnan(r) && (i += m) >= n)
+                    {
+                        r = c;
+                    }
+                });
+                
+                return r;
+            }
+        
+        private:
+        
+            // Total number of bases
+            Counts _n = 0;
+        
+            // Number of bases for integral coverage up to Dense
+            std::vector<Counts> _dense;
+        
+            // Number of bases for everything else
+            std::map<Coverage, Counts> _sparse;
+    };
+    
     template <typename T> Hist createHist(const std::set<T> & t)
     {
         Hist hist;
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <iostream>
 #include <memory>
+#include <cstdint>
 
 template <class T, typename K = std::size_t>
 class Interval_ {
@@ -234,4 +235,145 @@ public:
 
 };
 
+/*
+ * Flattened interval tree (implicit augmented tree over intervals sorted by start, as in cgranges).
+ * Intervals are stored in a single array, each node keeps the maximum stop in its subtree. Queries
+ * don't allocate, matches are visited in the order of their starts. The visitor returns false to
+ * stop the query.
+ */
+
+template <class T, typename K = std::size_t>
+class FlatIntervalTree {
+
+public:
+    typedef Interval_<T,K> interval;
+    typedef std::vector<interval> intervalVector;
+
+    FlatIntervalTree() : root(-1) { }
+
+    FlatIntervalTree(intervalVector ivals) : data(std::move(ivals)) {
+        IntervalStartSorter<T,K> intervalStartSorter;
+        std::sort(data.begin(), data.end(), intervalStartSorter);
+        index();
+    }
+
+    std::size_t size() const { return data.size(); }
+
+    template <typename F> void visitOverlapping(K start, K stop, F f) const {
+        visit(start, stop, [&](const interval &i) {
+            return i.stop >= start ? f(i) : true;
+        });
+    }
+
+    template <typename F> void visitContains(K start, K stop, F f) const {
+        visit(start, stop, [&](const interval &i) {
+            return (i.start <= start && stop <= i.stop) ? f(i) : true;
+        });
+    }
+
+    // Append to caller-supplied buffer
+    void findOverlapping(K start, K stop, intervalVector& overlapping) const {
+        visitOverlapping(start, stop, [&](const interval &i) { overlapping.push_back(i); return true; });
+    }
+
+    // Append to caller-supplied buffer
+    void findContains(K start, K stop, intervalVector& contained) const {
+        visitContains(start, stop, [&](const interval &i) { contained.push_back(i); return true; });
+    }
+
+private:
+
+    // Compute the maximum stops bottom-up, returns the level of the root
+    void index() {
+        const auto n = static_cast<std::int64_t>(data.size());
+        max.resize(n);
+
+        root = -1;
+        if (n == 0) {
+            return;
+        }
+
+        std::int64_t lastI = 0;
+        K last = 0;
+
+        for (std::int64_t i = 0; i < n; i += 2) {
+            lastI = i;
+            last = max[i] = data[i].stop;
+        }
+
+        int k;
+        for (k = 1; (std::int64_t(1) << k) <= n; ++k) {
+            const std::int64_t x = std::int64_t(1) << (k - 1), i0 = (x << 1) - 1, step = x << 2;
+
+            for (std::int64_t i = i0; i < n; i += step) {
+                const auto el = max[i - x];
+                const auto er = i + x < n ? max[i + x] : last;
+                max[i] = std::max(data[i].stop, std::max(el, er));
+            }
+
+            // Parent of the last node
+            lastI = (lastI >> k & 1) ? lastI - x : lastI + x;
+            if (lastI < n && max[lastI] > last) {
+                last = max[lastI];
+            }
+        }
+
+        root = k - 1;
+    }
+
+    // Visit every interval that might overlap (start <= stop of the query), f does the exact check
+    template <typename F> void visit(K start, K stop, F f) const {
+        if (root < 0) {
+            return;
+        }
+
+        struct Node { std::int64_t x; int k, w; };
+
+        const auto n = static_cast<std::int64_t>(data.size());
+        Node stack[64];
+        int t = 0;
+
+        stack[t++] = Node { (std::int64_t(1) << root) - 1, root, 0 };
+
+        while (t) {
+            const auto z = stack[--t];
+
+            // Small subtree, scan it linearly
+            if (z.k <= 3) {
+                const auto i0 = z.x >> z.k << z.k;
+                const auto i1 = std::min(i0 + (std::int64_t(1) << (z.k + 1)) - 1, n);
+
+                for (auto i = i0; i < i1 && data[i].start <= stop; ++i) {
+                    if (!f(data[i])) {
+                        return;
+                    }
+                }
+            } else if (z.w == 0) {
+                // Left child processed next, then back to this node
+                const auto y = z.x - (std::int64_t(1) << (z.k - 1));
+                stack[t++] = Node { z.x, z.k, 1 };
+
+                if (y >= n || max[y] >= start) {
+                    stack[t++] = Node { y, z.k - 1, 0 };
+                }
+            } else if (z.x < n && data[z.x].start <= stop) {
+                if (!f(data[z.x])) {
+                    return;
+                }
+
+                stack[t++] = Node { z.x + (std::int64_t(1) << (z.k - 1)), z.k - 1, 0 };
+            }
+        }
+    }
+
+    // Sorted by start
+    intervalVector data;
+
+    // Maximum stop in the subtree
+    std::vector<K> max;
+
+    // Level of the root (-1 if empty)
+    int root;
+};
+
 #endif
\ No newline at end of file
@@ -4,7 +4,9 @@
 #include <set>
 #include <map>
 #include <cmath>
+#include <vector>
 #include <numeric>
+#include <algorithm>
 #include "data/data.hpp"
 #include "data/itree.hpp"
 #include "data/locus.hpp"
@@ -12,6 +14,105 @@
 
 namespace Anaquin
 {
+    /*
+     * Bases covered in a region, kept as disjoint runs sorted by position. Marking in sorted
+     * order (eg: sorted alignments) only touches the last run. The runs are keyed by their last
+     * base like a map.
+     */
+
+    class CoveredRuns
+    {
+        public:
+        
+            struct Run
+            {
+                Base start, end;
+                
+                inline Base length() const { return end - start + 1; }
+            };
+        
+            typedef std::vector<Run>::const_iterator const_iterator;
+        
+            inline const_iterator begin() const { return _runs.begin(); }
+            inline const_iterator end()   const { return _runs.end();   }
+        
+            inline std::size_t size() const { return _runs.size(); }
+            inline bool empty()       const { return _runs.empty(); }
+        
+            // Number of bases covered
+            inline Base covered() const { return _n; }
+        
+            // Number of runs ending at the base (either 0 or 1)
+            inline std::size_t count(Base end) const
+            {
+                const auto i = lowerBound(end);
+                return i != _runs.size() && _runs[i].end == end;
+            }
+        
+            // Run ending at the base
+            inline const Run &operator[](Base end) const
+            {
+                A_CHECK(count(end), "No run ending at " + std::to_string(end));
+                return _runs[lowerBound(end)];
+            }
+        
+            // Index of the first run ending at or after the base
+            inline std::size_t lowerBound(Base x) const
+            {
+                const auto n = _runs.size();
+            
+                // Likely in sorted order (after or within the last run)
+                if (!n || _runs[n-1].end < x)
+                {
+                    return n;
+                }
+                else if (n == 1 || _runs[n-2].end < x)
+                {
+                    return n - 1;
+                }
+            
+                return std::lower_bound(_runs.begin(), _runs.end(), x, [&](const Run &r, Base x)
+                {
+                    return r.end < x;
+                }) - _runs.begin();
+            }
+        
+            /*
+             * Replace the runs [i, j) with a new run (j == i for inserting), returns the index of
+             * the new run.
+             */
+        
+            inline std::size_t replace(std::size_t i, std::size_t j, Base start, Base end)
+            {
+                for (auto k = i; k < j; k++)
+                {
+                    _n -= _runs[k].length();
+                }
+            
+                if (j == i)
+                {
+                    _runs.insert(_runs.begin() + i, Run { start, end });
+                }
+                else
+                {
+                    _runs[i] = Run { start, end };
+                    _runs.erase(_runs.begin() + i + 1, _runs.begin() + j);
+                }
+            
+                _n += end - start + 1;
+                return i;
+            }
+        
+            inline const Run &at(std::size_t i) const { return _runs[i]; }
+        
+        private:
+        
+            std::vector<Run> _runs;
+        
+            // Sum of the run lengths
+            Base _n = 0;
+    };
+
     class MergedInterval : public Matched
     {
         public:
@@ -43,11 +144,7 @@ namespace Anaquin
             {
                 Stats stats;
 
-                for (const auto &i : _data)
-                {
-                    stats.nonZeros += i.second.length();
-                }
-                
+                stats.nonZeros = _data.covered();
                 stats.length = _l.length();
                 assert(stats.length >= stats.nonZeros);
 
@@ -72,19 +169,21 @@ namespace Anaquin
         
             inline IntervalID name() const override { return id(); }
         
-            inline std::size_t size() { return _data.size(); }
-        
-        //private:
+            // Position among the intervals, assigned by MergedIntervals::build()
+            inline std::size_t index() const { return _i; }
         
-            // The first base of the mini-region
-            Base _x = NAN;
+            // Number of disjoint covered runs
+            inline std::size_t size() const { return _data.size(); }
         
-            // The last base of the mini-region
-            Base _y = NAN;
+        //private:
         
             Locus _l;
 
-            std::map<Base, Locus> _data;
+            // Dense handle for accounting by arrays
+            std::size_t _i = 0;
+        
+            // Bases covered by map()
+            CoveredRuns _data;
         
             GeneID  _gID;
             TransID _tID;
@@ -107,6 +206,32 @@ namespace Anaquin
         
             typedef std::map<typename T::IntervalID, T> IntervalData;
 
+            MergedIntervals() = default;
+            MergedIntervals(MergedIntervals &&) = default;
+            MergedIntervals &operator=(MergedIntervals &&) = default;
+        
+            // The tree holds pointers to the intervals, a copy must have its own tree
+            MergedIntervals(const MergedIntervals &x) : _inters(x._inters)
+            {
+                if (x._tree)
+                {
+                    build();
+                }
+            }
+        
+            inline MergedIntervals &operator=(const MergedIntervals &x)
+            {
+                _inters = x._inters;
+                _tree.reset();
+                
+                if (x._tree)
+                {
+                    build();
+                }
+                
+                return *this;
+            }
+
             inline void add(const T &i)
             {
                 _inters.insert(typename std::map<typename T::IntervalID, T>::value_type(i.id(), i));
@@ -139,12 +264,14 @@ namespace Anaquin
             
                 for (auto &i : _inters)
                 {
+                    // Intervals are numbered in the order of their IDs
+                    i.second._i = loci.size();
                     loci.push_back(LOCUS_TO_TINTERVAL(i.second));
                 }
                 
                 A_CHECK(!loci.empty(), "No interval was built. Zero interval.");
             
-                _tree = std::shared_ptr<IntervalTree<T *>>(new IntervalTree<T *> { loci });
+                _tree = std::shared_ptr<FlatIntervalTree<T *>>(new FlatIntervalTree<T *>(std::move(loci)));
 
                 A_CHECK(_tree, "Failed to build interval treee");
             }
@@ -167,11 +294,9 @@ namespace Anaquin
                     return nullptr;
                 }
                 
-                auto v = _tree->findContains(l.start, l.end);
-
                 T *t = nullptr;
     
-                for (const auto &i : v)
+                _tree->visitContains(l.start, l.end, [&](const Interval_<T *> &i)
                 {
                     if (i.value->l() == l)
                     {
@@ -182,7 +307,9 @@ namespace Anaquin
                             r->push_back(t);
                         }
                     }
-                }
+                    
+                    return true;
+                });
             
                 return t;
             }
@@ -195,19 +322,25 @@ namespace Anaquin
                     return nullptr;
                 }
 
-                auto v = _tree->findContains(l.start, l.end);
-
-                if (r)
+                T *t = nullptr;
+                
+                // Stop at the first match unless everything is needed
+                _tree->visitContains(l.start, l.end, [&](const Interval_<T *> &i)
                 {
-                    for (const auto &i : v)
+                    if (!t)
+                    {
+                        t = i.value;
+                    }
+                    
+                    if (r)
                     {
-                        if (i.value)
-                        
                         r->push_back(i.value);
                     }
-                }
+                    
+                    return r != nullptr;
+                });
             
-                return v.empty() ? nullptr : v.front().value;
+                return t;
             }
         
             inline T * overlap(const Locus &l, std::vector<T *> *r = nullptr) const
@@ -218,17 +351,25 @@ namespace Anaquin
                     return nullptr;
                 }
 
-                auto v = _tree->findOverlapping(l.start, l.end);
-            
-                if (r)
+                T *t = nullptr;
+                
+                // Stop at the first match unless everything is needed
+                _tree->visitOverlapping(l.start, l.end, [&](const Interval_<T *> &i)
                 {
-                    for (const auto &i : v)
+                    if (!t)
+                    {
+                        t = i.value;
+                    }
+                    
+                    if (r)
                     {
                         r->push_back(i.value);
                     }
-                }
+                    
+                    return r != nullptr;
+                });
             
-                return v.empty() ? nullptr : v.front().value;
+                return t;
             }
 
             typename MergedIntervals::Stats stats() const
@@ -271,7 +412,7 @@ namespace Anaquin
         
         //private:
         
-            std::shared_ptr<IntervalTree<T *>> _tree;
+            std::shared_ptr<FlatIntervalTree<T *>> _tree;
         
             IntervalData _inters;
     };
@@ -25,6 +25,7 @@ Reader::Reader(const Reader &r)
 {
     _imp = new ReaderInternal();
     _imp->line = r._imp->line;
+    _imp->file = r._imp->file;
     _imp->f = r._imp->f;
     _imp->s = r._imp->s;
 
@@ -98,6 +99,11 @@ std::string Reader::src() const
     return _imp->file;
 }
 
+bool Reader::isFile() const
+{
+    return _imp->f != nullptr;
+}
+
 bool Reader::nextLine(std::string &line) const
 {
     retry:
@@ -33,6 +33,9 @@ namespace Anaquin
         
             // Returns description for the source
             std::string src() const;
+
+            // Whether the source is a physical file (the file name is given by src())
+            bool isFile() const;
         
             // Returns the next line in the file
             bool nextLine(std::string &) const;
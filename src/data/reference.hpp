@@ -1,6 +1,7 @@
 #ifndef REFERENCE_HPP
 #define REFERENCE_HPP
 
+#include <unordered_set>
 #include "data/hist.hpp"
 #include "data/bData.hpp"
 #include "data/reader.hpp"
@@ -108,10 +109,14 @@ namespace Anaquin
 
             typedef std::set<SequinID> SequinIDs;
 
-            inline SequinIDs seqs()   const { return _seqs; }
-            inline SequinIDs seqsL1() const { return _l1->seqs; }
-            inline SequinIDs seqsL2() const { return _l2->seqs; }
-            inline SequinIDs seqsL3() const { return _l3->seqs; }
+            inline const SequinIDs &seqs()   const { return _seqs; }
+            inline const SequinIDs &seqsL1() const { return _l1->seqs; }
+            inline const SequinIDs &seqsL2() const { return _l2->seqs; }
+            inline const SequinIDs &seqsL3() const { return _l3->seqs; }
+
+            // Hashed membership, cheaper than seqsL1().count()
+            inline bool isSeqL1(const SequinID &x) const { return _h1->count(x); }
+            inline bool isSeqL2(const SequinID &x) const { return _h2->count(x); }
 
             inline Name t1(const Name &x) const { return _t1->translate(x); }
             inline Name t2(const Name &x) const { return _t2->translate(x); }
@@ -142,10 +147,15 @@ namespace Anaquin
 
             inline std::shared_ptr<GTFData> gtf() const { return _g1; }
 
-            inline Chr2DInters regs1()  const { return _r1->inters();  }
-            inline Chr2DInters regs2()  const { return _r2->inters();  }
-            inline Chr2MInters mRegs1() const { return _r1->minters(); }
-            inline Chr2MInters mRegs2() const { return _r2->minters(); }
+            /*
+             * Regions are built once the reference is finalized. Copy them (a copy has its own
+             * interval tree) before mapping any alignment.
+             */
+        
+            inline const Chr2DInters &regs1()  const { assert(_regs1);  return *_regs1;  }
+            inline const Chr2DInters &regs2()  const { assert(_regs2);  return *_regs2;  }
+            inline const Chr2MInters &mRegs1() const { assert(_mRegs1); return *_mRegs1; }
+            inline const Chr2MInters &mRegs2() const { assert(_mRegs2); return *_mRegs2; }
         
             inline std::shared_ptr<VCFLadder> vcf1() const { return _v1; }
             inline std::shared_ptr<VCFLadder> vcf2() const { return _v2; }
@@ -153,16 +163,117 @@ namespace Anaquin
             inline Counts nRegs() const { return _r1->count();  }
             inline Counts lRegs() const { return _r1->length(); }
         
-            inline MergedIntervals<> mInters(const ChrID &cID) const { return _r1->minters(cID); }
-            inline Chr2MInters mInters() const { return _r1->minters(); }
+            inline const MergedIntervals<> &mInters(const ChrID &cID) const { return mRegs1().at(cID); }
+            inline const Chr2MInters &mInters() const { return mRegs1(); }
+        
+            /*
+             * Regions (regs1) containing the loci on a chromosome, the loci must be sorted by their
+             * starts. Regions sorted by their starts are swept once with the loci (merge-join).
+             * Results are aligned with the loci, nullptr if not found (or no regions were cached).
+             */
+        
+            inline std::vector<const MergedInterval *> findR1(const ChrID &cID, const std::vector<Locus> &loci) const
+            {
+                std::vector<const MergedInterval *> r(loci.size(), nullptr);
+                
+                if (!_sRegs1)
+                {
+                    return r;
+                }
+                
+                const auto i = _sRegs1->find(cID);
+                
+                if (i == _sRegs1->end())
+                {
+                    return r;
+                }
+                
+                const auto &regs = i->second;
+
+                // Regions started before the current locus and not yet passed
+                std::vector<const MergedInterval *> active;
+                
+                // Next region to be activated
+                std::size_t next = 0;
+
+                for (auto j = 0; j < loci.size(); j++)
+                {
+                    const auto &l = loci[j];
+                    
+                    A_CHECK(!j || loci[j-1].start <= l.start, "Loci must be sorted by position");
+                    
+                    while (next < regs.size() && regs[next]->l().start <= l.start)
+                    {
+                        active.push_back(regs[next++]);
+                    }
+                    
+                    // Regions ending before the locus can't contain anything later
+                    active.erase(std::remove_if(active.begin(), active.end(), [&](const MergedInterval *x)
+                    {
+                        return x->l().end < l.start;
+                    }), active.end());
+                    
+                    for (const auto &k : active)
+                    {
+                        if (k->l().end >= l.end)
+                        {
+                            r[j] = k;
+                            break;
+                        }
+                    }
+                }
+                
+                return r;
+            }
 
             inline void finalize(Tool x, const UserReference &r)
             {
                 validate(x, r);
+                cache();
             }
 
         protected:
 
+            // Build everything that will be queried repeatedly
+            inline void cache()
+            {
+                typedef std::unordered_set<SequinID> Hashed;
+                
+                _h1 = _l1 ? std::make_shared<Hashed>(_l1->seqs.begin(), _l1->seqs.end()) : std::make_shared<Hashed>();
+                _h2 = _l2 ? std::make_shared<Hashed>(_l2->seqs.begin(), _l2->seqs.end()) : std::make_shared<Hashed>();
+                
+                if (_r1)
+                {
+                    _regs1  = std::make_shared<Chr2DInters>(_r1->inters());
+                    _mRegs1 = std::make_shared<Chr2MInters>(_r1->minters());
+                    
+                    auto x = std::make_shared<std::map<ChrID, std::vector<const MergedInterval *>>>();
+                    
+                    for (const auto &i : *_mRegs1)
+                    {
+                        auto &v = (*x)[i.first];
+                        
+                        for (const auto &j : i.second.data())
+                        {
+                            v.push_back(&j.second);
+                        }
+                        
+                        std::sort(v.begin(), v.end(), [&](const MergedInterval *a, const MergedInterval *b)
+                        {
+                            return a->l().start < b->l().start;
+                        });
+                    }
+                    
+                    _sRegs1 = x;
+                }
+                
+                if (_r2)
+                {
+                    _regs2  = std::make_shared<Chr2DInters>(_r2->inters());
+                    _mRegs2 = std::make_shared<Chr2MInters>(_r2->minters());
+                }
+            }
+
             inline void build(std::shared_ptr<BedData> r1)
             {
                 _r1 = r1;
@@ -333,6 +444,16 @@ namespace Anaquin
 
             // Translation
             std::shared_ptr<Translate> _t1, _t2;
+        
+            // Hashed sequins in the ladders
+            std::shared_ptr<const std::unordered_set<SequinID>> _h1, _h2;
+        
+            // Cached sequin regions
+            std::shared_ptr<const Chr2DInters> _regs1, _regs2;
+            std::shared_ptr<const Chr2MInters> _mRegs1, _mRegs2;
+        
+            // Cached regions (regs1) sorted by their starts, pointing into _mRegs1
+            std::shared_ptr<const std::map<ChrID, std::vector<const MergedInterval *>>> _sRegs1;
     };
 
     /*
@@ -401,9 +522,6 @@ namespace Anaquin
      * -------------------- Transcriptome Referenceb --------------------
      */
     
-    struct GeneData;
-    struct TransData;
-    
     class RnaRef : public Reference
     {
         public:
@@ -213,6 +213,10 @@ template <typename F, typename T = VCFData> T parseVCF2(const Reader &r, F f)
 {
     T t;
     
+    // Fields in the reference VCF
+    const auto fields = ParserVCF::Fields({ VCFInfo::CX, VCFInfo::GT, VCFInfo::CP, VCFInfo::AF },
+                                          { VCFFormat::GT });
+    
     ParserVCF::parse(r, [&](const Variant &x)
     {
         if (f(x))
@@ -220,7 +224,7 @@ template <typename F, typename T = VCFData> T parseVCF2(const Reader &r, F f)
             t[x.cID].b2v[x.l.start] = x;
             t[x.cID].m2v[x.type()].insert(x);
         }
-    });
+    }, fields);
     
     return t;
 }
@@ -281,20 +285,24 @@ VCFLadder Standard::addVCF(const Reader &r, const std::set<SequinVariant::Contex
                 throw std::runtime_error(r.src() + " doesn't seem to be a valid VCF reference file. Reason: " + x);
             };
             
-            if (!x.ifs.count("CX") || !m1.count(x.ifs.at("CX")))
+            if (!x.hasInfo(VCFInfo::CX) || !m1.count(x.infoS(VCFInfo::CX)))
             {
                 throwInvalidRef("The CX field is not found or invalid");
             }
-            else if (!x.ifs.count("GT") || !m2.count(x.ifs.at("GT")))
+            else if (!x.hasInfo(VCFInfo::GT) || !m2.count(x.infoS(VCFInfo::GT)))
             {
                 throwInvalidRef("The GT field is not found or invalid");
             }
+            else if (!x.hasInfo(VCFInfo::CP))
+            {
+                throwInvalidRef("The CP field is not found");
+            }
             
             SequinVariant s;
             
-            s.gt   = m2.at(x.ifs.at("GT"));
-            s.ctx  = m1.at(x.ifs.at("CX"));
-            s.copy = x.iff.at("CP");
+            s.gt   = m2.at(x.infoS(VCFInfo::GT));
+            s.ctx  = m1.at(x.infoS(VCFInfo::CX));
+            s.copy = x.info(VCFInfo::CP);
             
             if (f.count(s.ctx))
             {
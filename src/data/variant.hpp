@@ -3,6 +3,7 @@
 
 #include <map>
 #include <cmath>
+#include <vector>
 #include "data/locus.hpp"
 #include "data/biology.hpp"
 #include <boost/format.hpp>
@@ -24,6 +25,39 @@ namespace Anaquin
         NotFilted,
     };
     
+    // INFO fields understood by ParserVCF
+    enum class VCFInfo
+    {
+        CS,         // String
+        CX,         // String
+        GN,         // String
+        GT,         // String
+        AF,         // Float
+        CP,         // Float
+        DP,         // Integer
+        SVLEN,      // Integer
+        QSI,        // Integer (Strelka)
+        QSS,        // Integer (Strelka)
+        SomaticEVS, // Float (Strelka)
+        Count
+    };
+
+    // FORMAT fields understood by ParserVCF
+    enum class VCFFormat
+    {
+        GT,
+        AD,
+        AF,
+        DP,
+        TAR, // Strelka
+        TIR, // Strelka
+        AU,  // Strelka
+        CU,  // Strelka
+        GU,  // Strelka
+        TU,  // Strelka
+        Count
+    };
+    
     /*
      * This class represents a VCF variant. Not everything in a VCF file is important, only
      * the required fields are included.
@@ -107,14 +141,65 @@ namespace Anaquin
         // Depth coverage (eg: DP for VCF and REF+ALT for VarScan)
         Counts depth = NAN;
         
-        std::map<std::string, int> ifi;
-        std::map<std::string, float> iff;
-        std::map<std::string, std::string> ifs;
+        // Whether the INFO field is decoded and not missing
+        inline bool hasInfo(VCFInfo i) const
+        {
+            return _info & (1u << static_cast<unsigned>(i));
+        }
         
-        std::map<std::string, int> fi;
-        std::map<std::string, float> ff;
+        // Numerical value of the INFO field (first value if multiple), NAN if not available
+        inline double info(VCFInfo i) const
+        {
+            return hasInfo(i) ? _iv[static_cast<unsigned>(i)] : NAN;
+        }
+        
+        // String value of the INFO field, empty if not available
+        inline const std::string &infoS(VCFInfo i) const
+        {
+            return _is[static_cast<unsigned>(i)];
+        }
+        
+        /*
+         * Value of a FORMAT field in a sample (both starting from zero). Eg: format(AD, 1, 0) is the
+         * first value in the second sample. NAN if not available.
+         */
+        
+        inline double format(VCFFormat f, std::size_t s, std::size_t i = 0) const
+        {
+            const auto j = static_cast<unsigned>(f);
+            
+            if (i >= _fn[j] || _fo[j] + (s + 1) * _fn[j] > _fo[j+1])
+            {
+                return NAN;
+            }
+
+            return _fv[_fo[j] + s * _fn[j] + i];
+        }
+        
+        inline bool hasFormat(VCFFormat f, std::size_t s, std::size_t i = 0) const
+        {
+            return !std::isnan(format(f, s, i));
+        }
         
         void *hdr, *line;
+        
+        // Decoded INFO fields (bitwise)
+        unsigned _info = 0;
+        
+        // Numerical INFO values
+        double _iv[static_cast<unsigned>(VCFInfo::Count)];
+        
+        // String INFO values
+        std::string _is[static_cast<unsigned>(VCFInfo::Count)];
+        
+        // FORMAT values for all samples, missing values are NAN
+        std::vector<double> _fv;
+
+        // Offsets of the FORMAT fields in _fv
+        unsigned _fo[static_cast<unsigned>(VCFFormat::Count) + 1] = {};
+        
+        // Number of values per sample for the FORMAT fields
+        unsigned _fn[static_cast<unsigned>(VCFFormat::Count)] = {};
     };
 }
 
@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <strings.h>
+#include <algorithm>
 #include <execinfo.h>
 #include <sys/stat.h>
 
@@ -78,6 +79,13 @@ typedef std::set<Value> Range;
 #define OPT_U_SEQS   814
 #define OPT_EDGE     817
 #define OPT_U_BASE   818
+#define OPT_THREAD   819
+#define OPT_FORMAT   820
+#define OPT_LEVEL    821
+#define OPT_INDEX    822
+#define OPT_MEMORY   823
+#define OPT_GZIP     824
+#define OPT_CACHE    825
 
 using namespace Anaquin;
 
@@ -93,6 +101,27 @@ Path __working__;
 // Shared with other modules
 Path __output__;
 
+// Shared with other modules
+unsigned __threads__ = 1;
+
+// Shared with other modules
+std::string __format__ = "SAM";
+
+// Shared with other modules
+int __level__ = -1;
+
+// Shared with other modules
+bool __index__ = false;
+
+// Shared with other modules
+unsigned __memory__ = 2048;
+
+// Shared with other modules
+bool __gzip__ = false;
+
+// Shared with other modules
+Path __cache__;
+
 // Shared with other modules
 std::string date()
 {
@@ -198,6 +227,27 @@ struct Parsing
     
     Proportion sampled = NAN;
     
+    // Number of threads for parsing alignments
+    unsigned threads = 1;
+    
+    // Format for subsampled alignments (SAM, BAM or CRAM)
+    std::string format = "SAM";
+    
+    // Compression level for subsampled alignments (-1 for the default)
+    int level = -1;
+    
+    // Whether to index subsampled alignments
+    bool index = false;
+    
+    // Memory (MB) for pairing mates before spilling to disk
+    unsigned memory = 2048;
+    
+    // Whether to compress FASTQ output
+    bool gzip = false;
+    
+    // Directory for caching parsed annotations (empty for no caching)
+    Path cache;
+    
     Tool tool;
 };
 
@@ -304,6 +354,15 @@ static const struct option long_options[] =
     { "edge",    required_argument, 0, OPT_EDGE   },
     { "fuzzy",   required_argument, 0, OPT_FUZZY  },
     
+    { "threads", required_argument, 0, OPT_THREAD },
+    
+    { "format",  required_argument, 0, OPT_FORMAT },
+    { "level",   required_argument, 0, OPT_LEVEL  },
+    { "index",   no_argument,       0, OPT_INDEX  },
+    { "memory",  required_argument, 0, OPT_MEMORY },
+    { "gzip",    no_argument,       0, OPT_GZIP   },
+    { "cache",   required_argument, 0, OPT_CACHE  },
+    
     { "o",       required_argument, 0, OPT_PATH },
 
     {0, 0, 0, 0 }
@@ -633,6 +692,13 @@ void parse(int argc, char ** argv)
     auto &tool = _p.tool;
     
     _p = Parsing();
+    __threads__ = _p.threads;
+    __format__  = _p.format;
+    __level__   = _p.level;
+    __index__   = _p.index;
+    __memory__  = _p.memory;
+    __gzip__    = _p.gzip;
+    __cache__   = _p.cache;
 
     if (argc <= 1)
     {
@@ -767,6 +833,111 @@ void parse(int argc, char ** argv)
                 break;
             }
 
+            case OPT_THREAD:
+            {
+                int n;
+                
+                try
+                {
+                    n = stoi(val);
+                }
+                catch (...)
+                {
+                    throw std::runtime_error(val + " is not an integer. Please check and try again.");
+                }
+                
+                if (n < 1)
+                {
+                    throw std::runtime_error("Invalid value for -threads. Number of threads must be at least one.");
+                }
+
+                __threads__ = _p.threads = n;
+                _p.opts[opt] = val;
+                break;
+            }
+
+            case OPT_FORMAT:
+            {
+                auto x = val;
+                std::transform(x.begin(), x.end(), x.begin(), ::toupper);
+                
+                if (x != "SAM" && x != "BAM" && x != "CRAM")
+                {
+                    throw std::runtime_error("Invalid value for -format. Should be SAM, BAM or CRAM.");
+                }
+                
+                __format__ = _p.format = x;
+                _p.opts[opt] = val;
+                break;
+            }
+                
+            case OPT_LEVEL:
+            {
+                int n;
+                
+                try
+                {
+                    n = stoi(val);
+                }
+                catch (...)
+                {
+                    throw std::runtime_error(val + " is not an integer. Please check and try again.");
+                }
+                
+                if (n < 0 || n > 9)
+                {
+                    throw std::runtime_error("Invalid value for -level. Compression level must be between 0 and 9.");
+                }
+                
+                __level__ = _p.level = n;
+                _p.opts[opt] = val;
+                break;
+            }
+
+            case OPT_INDEX:
+            {
+                __index__ = _p.index = true;
+                _p.opts[opt] = val;
+                break;
+            }
+
+            case OPT_MEMORY:
+            {
+                int n;
+                
+                try
+                {
+                    n = stoi(val);
+                }
+                catch (...)
+                {
+                    throw std::runtime_error(val + " is not an integer. Please check and try again.");
+                }
+                
+                if (n < 1)
+                {
+                    throw std::runtime_error("Invalid value for -memory. Memory must be at least 1MB.");
+                }
+                
+                __memory__ = _p.memory = n;
+                _p.opts[opt] = val;
+                break;
+            }
+
+            case OPT_GZIP:
+            {
+                __gzip__ = _p.gzip = true;
+                _p.opts[opt] = val;
+                break;
+            }
+
+            case OPT_CACHE:
+            {
+                __cache__ = _p.cache = val;
+                _p.opts[opt] = val;
+                break;
+            }
+
             case OPT_METHOD:
             {
                 switch (_p.tool)
@@ -1,10 +1,57 @@
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <exception>
+#include <sys/stat.h>
 #include <htslib/sam.h>
+#include "tools/queue.hpp"
 #include "tools/samtools.hpp"
 #include "parsers/parser_bam.hpp"
 #include <boost/algorithm/string/predicate.hpp>
 
 using namespace Anaquin;
 
+// Defined in main.cpp
+extern unsigned __threads__;
+
+// Number of alignments dispatched to a worker at once
+#define BLOCK_SIZE 4096
+
+unsigned ParserBAM::threads()
+{
+    return std::max(__threads__, 1u);
+}
+
+static samFile *open(const FileName &file)
+{
+    auto f = sam_open(file.c_str(), "r");
+    
+    if (!f)
+    {
+        throw std::runtime_error("Failed to open: " + file);
+    }
+    
+    // Decompress BGZF blocks in background threads
+    if (ParserBAM::threads() > 1)
+    {
+        hts_set_threads(f, ParserBAM::threads());
+    }
+    
+    return f;
+}
+
+boost::string_ref ParserBAM::Data::chr() const
+{
+    if (tid < 0)
+    {
+        return boost::string_ref("*");
+    }
+    
+    return boost::string_ref(static_cast<bam_hdr_t *>(_h)->target_name[tid]);
+}
+
 bool ParserBAM::Data::nextCigar(Locus &l, bool &spliced)
 {
     assert(_h && _b);
@@ -104,15 +151,191 @@ bool ParserBAM::Data::nextCigar(Locus &l, bool &spliced)
     return false;
 }
 
-void ParserBAM::parse(const FileName &file, Functor x, bool details)
+const std::string &ParserBAM::Data::sequence()
 {
-    auto f = sam_open(file.c_str(), "r");
+    if (!(_decoded & SEQ))
+    {
+        bam2seq(static_cast<bam1_t *>(_b), seq);
+        _decoded |= SEQ;
+    }
     
-    if (!f)
+    return seq;
+}
+
+const std::string &ParserBAM::Data::quality()
+{
+    if (!(_decoded & QUAL))
     {
-        throw std::runtime_error("Failed to open: " + file);
+        bam2qual(static_cast<bam1_t *>(_b), qual);
+        _decoded |= QUAL;
+    }
+    
+    return qual;
+}
+
+const std::string &ParserBAM::Data::cigarStr()
+{
+    if (!(_decoded & CIGAR))
+    {
+        if (tid >= 0)
+        {
+            bam2cigar(static_cast<bam1_t *>(_b), cigar);
+        }
+        else
+        {
+            cigar = "*";
+        }
+        
+        _decoded |= CIGAR;
+    }
+    
+    return cigar;
+}
+
+const ChrID &ParserBAM::Data::mateChr()
+{
+    if (!(_decoded & MATE))
+    {
+        auto t = static_cast<bam1_t *>(_b);
+        auto h = static_cast<bam_hdr_t *>(_h);
+        
+        const auto hasCID = t->core.tid >= 0;
+
+        tlen  = hasCID ? t->core.isize : 0;
+        pnext = hasCID ? std::to_string(t->core.mpos) : "0";
+        rnext = hasCID ? bam2rnext(h, t) : "*";
+        
+        if (rnext == "=")
+        {
+            rnext = cID;
+        }
+        
+        _decoded |= MATE;
+    }
+    
+    return rnext;
+}
+
+void ParserBAM::decode(Data &align, Info &info, void *b, void *h_, bool details)
+{
+    auto t = static_cast<bam1_t *>(b);
+    auto h = static_cast<bam_hdr_t *>(h_);
+
+    info.length = h->target_len[t->core.tid];
+
+    align.mapped = false;
+    align.name   = bam_get_qname(t);
+    
+    info.b = t;
+    info.h = h;
+
+    align._b  = t;
+    align._h  = h;
+
+    align.mapq = t->core.qual;
+    align.flag = t->core.flag;
+    
+    const auto hasCID = t->core.tid >= 0;
+    
+    #define isPairedEnd(b)    (((b)->core.flag&0x1)   != 0)
+    #define isAllAligned(b)   (((b)->core.flag&0x2)   != 0)
+    #define isUnmapped(b)     (((b)->core.flag&0x4)   != 0)
+    #define isMateUnmapped(b) (((b)->core.flag&0x8)   != 0)
+    #define isReversed(b)     (((b)->core.flag&0x10)  != 0)
+    #define isMateReversed(b) (((b)->core.flag&0x20)  != 0)
+    #define isFirstPair(b)    (((b)->core.flag&0x40)  != 0)
+    #define isLastPair(b)     (((b)->core.flag&0x80)  != 0)
+    #define isSecondary(b)    (((b)->core.flag&0x100) != 0)
+    #define isFailed(b)       (((b)->core.flag&0x200) != 0)
+    #define isDuplicate(b)    (((b)->core.flag&0x400) != 0)
+    #define isSupplement(b)   (((b)->core.flag&0x800) != 0)
+    #define isPrimary(b)      (((b)->core.flag&0x900) == 0)
+
+    align.isPaired      = isPairedEnd(t);
+    align.isAllAligned  = isAllAligned(t);
+    align.isAligned     = !isUnmapped(t);
+    align.isMateAligned = !isMateUnmapped(t);
+    align.isForward     = !isReversed(t);
+    align.isMateReverse = isMateReversed(t);
+    align.isFirstPair   = isFirstPair(t);
+    align.isSecondPair  = isLastPair(t);
+    align.isPassed      = !isFailed(t);
+    align.isDuplicate   = isDuplicate(t);
+    align.isSupplement  = isSupplement(t);
+    align.isPrimary     = isPrimary(t);
+    align.isSecondary   = isSecondary(t);
+
+    align.tid = hasCID ? t->core.tid : -1;
+    
+    // Only build the name when the chromosome changes
+    if (align._cTid != align.tid)
+    {
+        align.cID   = hasCID ? h->target_name[t->core.tid] : "*";
+        align._cTid = align.tid;
+    }
+
+    if (!hasCID)
+    {
+        align.l.start = 0;
+        align.l.end = 0;
+    }
+
+    align._decoded = 0;
+
+    if (details)
+    {
+        align.sequence();
+        align.quality();
+        align.cigarStr();
+        align.mateChr();
     }
 
+    align.mapped = hasCID && !(t->core.flag & BAM_FUNMAP);
+
+    if (align.mapped)
+    {
+        const auto cigar = bam_get_cigar(t);
+
+        // Is this a multi alignment?
+        info.multi = t->core.n_cigar > 1;
+
+        /*
+         * Quickly check the properties of the alignment
+         */
+        
+        info.ins  = false;
+        info.del  = false;
+        info.clip = false;
+        info.skip = false;
+        
+        for (auto i = 0; i < t->core.n_cigar; i++)
+        {
+            switch (bam_cigar_op(cigar[i]))
+            {
+                case BAM_CINS:       { info.ins  = true; break; }
+                case BAM_CDEL:       { info.del  = true; break; }
+                case BAM_CREF_SKIP:  { info.skip = true; break; }
+                case BAM_CSOFT_CLIP: { info.clip = true; break; }
+                case BAM_CHARD_CLIP: { info.clip = true; break; }
+                case BAM_CPAD:       { info.del  = true; break; }
+                default: { break; }
+            }
+        }
+
+        #define RESET_CIGAR { align._i = 0; align._n = t->core.pos; }
+        
+        RESET_CIGAR
+
+        bool spliced;
+        align.nextCigar(align.l, spliced);
+        
+        RESET_CIGAR
+    }
+}
+
+void ParserBAM::parse(const FileName &file, Functor x, bool details)
+{
+    auto f = open(file);
     auto t = bam_init1();
     auto h = sam_hdr_read(f);
 
@@ -121,127 +344,494 @@ void ParserBAM::parse(const FileName &file, Functor x, bool details)
 
     while (sam_read1(f, h, t) >= 0)
     {
-        info.length = h->target_len[t->core.tid];
+        decode(align, info, t, h, details);
+        x(align, info);
+        info.p.i++;
+    }
 
-        align.mapped = false;
-        align.name   = bam_get_qname(t);
+    bam_destroy1(t);
+    bam_hdr_destroy(h);
+    sam_close(f);
+}
+
+bool ParserBAM::isSorted(const FileName &file, const std::string &order)
+{
+    auto f = open(file);
+    auto h = sam_hdr_read(f);
+    
+    const auto r = h && h->text && strstr(h->text, ("SO:" + order).c_str());
+    
+    if (h)
+    {
+        bam_hdr_destroy(h);
+    }
+    
+    sam_close(f);
+    return r;
+}
+
+bool ParserBAM::isIndexed(const FileName &file)
+{
+    auto f = open(file);
+    auto idx = sam_index_load(f, file.c_str());
+    
+    sam_close(f);
+    
+    if (!idx)
+    {
+        return false;
+    }
+    
+    hts_idx_destroy(idx);
+    
+    struct stat s;
+    
+    if (stat(file.c_str(), &s))
+    {
+        return false;
+    }
+    
+    // Eg: "A.bam.bai" and "A.bai" for "A.bam"
+    const auto base = file.substr(0, file.find_last_of('.'));
+    
+    for (const auto &i : { file + ".bai", file + ".csi", file + ".crai", base + ".bai", base + ".csi", base + ".crai" })
+    {
+        struct stat x;
         
-        info.b = t;
-        info.h = h;
+        // An index older than the file might not be for the file
+        if (!stat(i.c_str(), &x) && x.st_mtime < s.st_mtime)
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
 
-        align._b  = t;
-        align._h  = h;
+bool ParserBAM::countMapped(const FileName &file, Counts &n)
+{
+    auto f = open(file);
+    auto h = sam_hdr_read(f);
+    auto idx = sam_index_load(f, file.c_str());
+    
+    bool r = false;
+    
+    if (idx)
+    {
+        Counts m = 0;
+        
+        for (auto i = 0; i < h->n_targets; i++)
+        {
+            uint64_t mapped = 0, unmapped = 0;
+            
+            // Fails for contigs without reads, or if the index has no statistics (eg: CRAI)
+            if (hts_idx_get_stat(idx, i, &mapped, &unmapped) >= 0)
+            {
+                r  = true;
+                m += mapped;
+            }
+        }
+        
+        if (r)
+        {
+            n = m;
+        }
+        
+        hts_idx_destroy(idx);
+    }
+    
+    bam_hdr_destroy(h);
+    sam_close(f);
+    
+    return r;
+}
 
-        align.mapq = t->core.qual;
-        align.flag = t->core.flag;
+bool ParserBAM::parseRegions(const FileName &file, const Chr2DInters &regs, Functor x, bool details)
+{
+    auto f = open(file);
+    auto h = sam_hdr_read(f);
+    auto idx = sam_index_load(f, file.c_str());
+    
+    if (!idx)
+    {
+        bam_hdr_destroy(h);
+        sam_close(f);
         
-        const auto hasCID = t->core.tid >= 0;
+        // Nothing we can do without the index
+        parse(file, x, details);
+
+        return false;
+    }
+
+    auto t = bam_init1();
+
+    Info info;
+    Data align;
+
+    // For each chromosome...
+    for (const auto &i : regs)
+    {
+        const auto tid = bam_name2id(h, i.first.c_str());
         
-        #define isPairedEnd(b)    (((b)->core.flag&0x1)   != 0)
-        #define isAllAligned(b)   (((b)->core.flag&0x2)   != 0)
-        #define isUnmapped(b)     (((b)->core.flag&0x4)   != 0)
-        #define isMateUnmapped(b) (((b)->core.flag&0x8)   != 0)
-        #define isReversed(b)     (((b)->core.flag&0x10)  != 0)
-        #define isMateReversed(b) (((b)->core.flag&0x20)  != 0)
-        #define isFirstPair(b)    (((b)->core.flag&0x40)  != 0)
-        #define isLastPair(b)     (((b)->core.flag&0x80)  != 0)
-        #define isSecondary(b)    (((b)->core.flag&0x100) != 0)
-        #define isFailed(b)       (((b)->core.flag&0x200) != 0)
-        #define isDuplicate(b)    (((b)->core.flag&0x400) != 0)
-        #define isSupplement(b)   (((b)->core.flag&0x800) != 0)
-        #define isPrimary(b)      (((b)->core.flag&0x900) == 0)
-
-        align.isPaired      = isPairedEnd(t);
-        align.isAllAligned  = isAllAligned(t);
-        align.isAligned     = !isUnmapped(t);
-        align.isMateAligned = !isMateUnmapped(t);
-        align.isForward     = !isReversed(t);
-        align.isMateReverse = isMateReversed(t);
-        align.isFirstPair   = isFirstPair(t);
-        align.isSecondPair  = isLastPair(t);
-        align.isPassed      = !isFailed(t);
-        align.isDuplicate   = isDuplicate(t);
-        align.isSupplement  = isSupplement(t);
-        align.isPrimary     = isPrimary(t);
-        align.isSecondary   = isSecondary(t);
-
-        if (hasCID)
-        {
-            align.cID = std::string(h->target_name[t->core.tid]);
+        // Chromosome not in the alignment file?
+        if (tid < 0)
+        {
+            continue;
         }
-        else
+        
+        std::vector<Locus> loci;
+        
+        for (const auto &j : i.second.data())
         {
-            align.cID = "*";
-            align.l.start = 0;
-            align.l.end = 0;
+            loci.push_back(j.second.l());
         }
+        
+        // Last base of the previous region
+        Base last = 0;
 
-        if (details)
+        // Merged regions are sorted and not overlapping
+        for (const auto &l : Locus::merge<Locus, Locus>(loci))
         {
-            align.seq    = bam2seq(t);
-            align.qual   = bam2qual(t);
-            align.cigar  = hasCID ? bam2cigar(t) : "*";
-            align.tlen   = hasCID ? t->core.isize : 0;
-            align.pnext  = hasCID ? std::to_string(t->core.mpos) : "0";
-            align.rnext  = hasCID ? bam2rnext(h, t) : "*";
+            // Zero-based and half-open
+            auto iter = sam_itr_queryi(idx, tid, l.start - 1, l.end);
             
-            if (align.rnext == "=")
+            if (!iter)
             {
-                align.rnext = align.cID;
+                throw std::runtime_error("Failed to query " + i.first + " in " + file);
+            }
+            
+            while (sam_itr_next(f, iter, t) >= 0)
+            {
+                // Spanning the previous region? It has already been parsed.
+                if (t->core.pos + 1 <= last)
+                {
+                    continue;
+                }
+                
+                decode(align, info, t, h, details);
+                x(align, info);
+                info.p.i++;
             }
+            
+            hts_itr_destroy(iter);
+            last = l.end;
         }
+    }
+    
+    bam_destroy1(t);
+    hts_idx_destroy(idx);
+    bam_hdr_destroy(h);
+    sam_close(f);
+    
+    return true;
+}
 
-        align.mapped = hasCID && !(t->core.flag & BAM_FUNMAP);
-
-        if (align.mapped)
+void ParserBAM::parse(const FileName &file, unsigned n, WFunctor x, bool details)
+{
+    if (n <= 1)
+    {
+        return parse(file, [&](Data &align, const Info &info)
         {
-            const auto cigar = bam_get_cigar(t);
+            x(align, info, 0);
+        }, details);
+    }
 
-            // Is this a multi alignment?
-            info.multi = t->core.n_cigar > 1;
+    struct Block
+    {
+        // Index of the first alignment in the block
+        long long i;
+        
+        // Number of alignments in the block
+        std::size_t n;
+        
+        std::vector<bam1_t *> b;
+    };
+    
+    auto f = open(file);
+    auto h = sam_hdr_read(f);
 
-            /*
-             * Quickly check the properties of the alignment
-             */
-            
-            info.ins  = false;
-            info.del  = false;
-            info.clip = false;
-            info.skip = false;
+    /*
+     * Blocks are recycled between the reader and the workers. Having two blocks for each
+     * worker keeps the workers busy while the reader is filling the next block.
+     */
+    
+    std::vector<Block> blocks(2 * n);
+    
+    BoundedQueue<Block *> free(blocks.size()), full(blocks.size());
+    
+    for (auto &i : blocks)
+    {
+        for (auto j = 0; j < BLOCK_SIZE; j++)
+        {
+            i.b.push_back(bam_init1());
+        }
+
+        free.push(&i);
+    }
+    
+    std::mutex m;
+    std::exception_ptr err;
+    std::atomic<bool> stopped(false);
+    
+    std::vector<std::thread> workers;
+    
+    for (unsigned w = 0; w < n; w++)
+    {
+        workers.push_back(std::thread([&, w]()
+        {
+            Info info;
+            Data align;
+            Block *k;
             
-            for (auto i = 0; i < t->core.n_cigar; i++)
+            while (full.pop(k))
             {
-                switch (bam_cigar_op(cigar[i]))
+                for (auto i = 0; i < k->n && !stopped; i++)
                 {
-                    case BAM_CINS:       { info.ins  = true; break; }
-                    case BAM_CDEL:       { info.del  = true; break; }
-                    case BAM_CREF_SKIP:  { info.skip = true; break; }
-                    case BAM_CSOFT_CLIP: { info.clip = true; break; }
-                    case BAM_CHARD_CLIP: { info.clip = true; break; }
-                    case BAM_CPAD:       { info.del  = true; break; }
-                    default: { break; }
+                    info.p.i = k->i + i;
+                    
+                    try
+                    {
+                        decode(align, info, k->b[i], h, details);
+                        x(align, info, w);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(m);
+                        
+                        if (!err)
+                        {
+                            err = std::current_exception();
+                        }
+                        
+                        stopped = true;
+                        free.close();
+                        full.close();
+                    }
                 }
+                
+                free.push(k);
+            }
+        }));
+    }
+    
+    long long i = 0;
+    
+    Block *k;
+    bool eof = false;
+    
+    while (!eof && !stopped && free.pop(k))
+    {
+        k->i = i;
+        k->n = 0;
+        
+        while (k->n < BLOCK_SIZE)
+        {
+            if (sam_read1(f, h, k->b[k->n]) < 0)
+            {
+                eof = true;
+                break;
             }
-
-            #define RESET_CIGAR { align._i = 0; align._n = t->core.pos; }
             
-            RESET_CIGAR
+            k->n++;
+        }
+        
+        i += k->n;
+        
+        if (k->n)
+        {
+            full.push(k);
+        }
+    }
+    
+    full.close();
+    
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+    
+    for (auto &i : blocks)
+    {
+        for (auto &j : i.b)
+        {
+            bam_destroy1(j);
+        }
+    }
+    
+    bam_hdr_destroy(h);
+    sam_close(f);
+    
+    if (err)
+    {
+        std::rethrow_exception(err);
+    }
+}
 
-            bool spliced;
-            align.nextCigar(align.l, spliced);
+void ParserBAM::parse(const FileName &file, const std::vector<Functor> &x, bool details)
+{
+    if (x.size() == 1)
+    {
+        return parse(file, x.front(), details);
+    }
+    
+    struct Block
+    {
+        // Index of the first alignment in the block
+        long long i;
+        
+        // Number of alignments in the block
+        std::size_t n;
+        
+        // Number of consumers yet to finish the block
+        std::atomic<std::size_t> pending;
+        
+        std::vector<bam1_t *> b;
+    };
+    
+    auto f = open(file);
+    auto h = sam_hdr_read(f);
+    
+    // Blocks are shared by the consumers and recycled once every consumer has finished them
+    std::vector<Block> blocks(4);
+    
+    BoundedQueue<Block *> free(blocks.size());
+    
+    for (auto &i : blocks)
+    {
+        for (auto j = 0; j < BLOCK_SIZE; j++)
+        {
+            i.b.push_back(bam_init1());
+        }
+        
+        free.push(&i);
+    }
+    
+    // Blocks waiting for each consumer
+    std::vector<std::shared_ptr<BoundedQueue<Block *>>> full;
+    
+    for (auto i = 0; i < x.size(); i++)
+    {
+        full.push_back(std::make_shared<BoundedQueue<Block *>>(blocks.size()));
+    }
+    
+    std::mutex m;
+    std::exception_ptr err;
+    std::atomic<bool> stopped(false);
+    
+    auto stop = [&]()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        
+        if (!err)
+        {
+            err = std::current_exception();
+        }
+        
+        stopped = true;
+        free.close();
+        
+        for (auto &i : full)
+        {
+            i->close();
+        }
+    };
+    
+    std::vector<std::thread> consumers;
+    
+    for (auto c = 0; c < x.size(); c++)
+    {
+        consumers.push_back(std::thread([&, c]()
+        {
+            Info info;
+            Data align;
+            Block *k;
+            
+            while (full[c]->pop(k))
+            {
+                for (auto i = 0; i < k->n && !stopped; i++)
+                {
+                    info.p.i = k->i + i;
+                    
+                    try
+                    {
+                        decode(align, info, k->b[i], h, details);
+                        x[c](align, info);
+                    }
+                    catch (...)
+                    {
+                        stop();
+                    }
+                }
+                
+                if (--k->pending == 0)
+                {
+                    free.push(k);
+                }
+            }
+        }));
+    }
+    
+    long long i = 0;
+    
+    Block *k;
+    bool eof = false;
+    
+    while (!eof && !stopped && free.pop(k))
+    {
+        k->i = i;
+        k->n = 0;
+        
+        while (k->n < BLOCK_SIZE)
+        {
+            if (sam_read1(f, h, k->b[k->n]) < 0)
+            {
+                eof = true;
+                break;
+            }
             
-            RESET_CIGAR
+            k->n++;
+        }
+        
+        i += k->n;
+        
+        if (k->n)
+        {
+            k->pending = x.size();
             
-            x(align, info);
+            for (auto &j : full)
+            {
+                if (!j->push(k))
+                {
+                    // Never reached by the consumer
+                    k->pending--;
+                }
+            }
         }
-        else
+    }
+    
+    for (auto &j : full)
+    {
+        j->close();
+    }
+    
+    for (auto &c : consumers)
+    {
+        c.join();
+    }
+    
+    for (auto &i : blocks)
+    {
+        for (auto &j : i.b)
         {
-            x(align, info);
+            bam_destroy1(j);
         }
-        
-        info.p.i++;
     }
-
-    bam_destroy1(t);
+    
+    bam_hdr_destroy(h);
     sam_close(f);
+    
+    if (err)
+    {
+        std::rethrow_exception(err);
+    }
 }
@@ -1,6 +1,10 @@
 #ifndef PARSER_BAM_HPP
 #define PARSER_BAM_HPP
 
+#include <vector>
+#include <utility>
+#include <boost/utility/string_ref.hpp>
+#include "data/dinters.hpp"
 #include "data/alignment.hpp"
 #include "stats/analyzer.hpp"
 #include "parsers/parser.hpp"
@@ -46,22 +50,186 @@ namespace Anaquin
                 inline void *b() const { return _b; }
                 inline void *h() const { return _h; }
 
+                // Name of the chromosome in the header, no copy
+                boost::string_ref chr() const;
+            
+                // Index of the chromosome in the header (-1 if not available)
+                int32_t tid = -1;
+            
+                /*
+                 * Decoded on the first call unless parsed with details, only valid until the next
+                 * alignment. Alignments parsed with details have these fields filled up-front.
+                 */
+            
+                const std::string &sequence();
+                const std::string &quality();
+                const std::string &cigarStr();
+            
+                // Chromosome of the mate (also fills tlen and pnext)
+                const ChrID &mateChr();
+            
             private:
             
+                enum Decoded
+                {
+                    SEQ   = 1,
+                    QUAL  = 2,
+                    CIGAR = 4,
+                    MATE  = 8
+                };
+            
+                // Fields decoded for the current alignment
+                int _decoded = 0;
+            
                 mutable int _i, _n;
 
+                // Chromosome that cID was built for
+                int32_t _cTid = -2;
+
                 void *_b;
                 void *_h;
         };
         
         typedef std::function<void (Data &, const Info &)> Functor;
         
+        /*
+         * Resolves alignments to the entries of a map keyed by chromosome. Each chromosome in the
+         * header is looked up once, thereafter it's an array access. Only valid for a single file
+         * because indexes are specific to the header.
+         */
+        
+        template <typename M> class ChrIndex
+        {
+            public:
+            
+                typedef decltype(&std::declval<M &>().begin()->second) Ptr;
+            
+                ChrIndex(M &m) : _m(m) {}
+            
+                // Null if the chromosome is not in the map
+                inline Ptr find(const Data &x)
+                {
+                    if (x.tid < 0)
+                    {
+                        return nullptr;
+                    }
+                    
+                    if (x.tid >= _x.size())
+                    {
+                        _x.resize(x.tid + 1, nullptr);
+                        _r.resize(x.tid + 1, false);
+                    }
+                    
+                    if (!_r[x.tid])
+                    {
+                        const auto i = _m.find(x.cID);
+                        
+                        _r[x.tid] = true;
+                        _x[x.tid] = i != _m.end() ? &i->second : nullptr;
+                    }
+                    
+                    return _x[x.tid];
+                }
+            
+            private:
+            
+                M &_m;
+            
+                // Resolved entries for each chromosome
+                std::vector<Ptr> _x;
+            
+                // Whether the chromosome has been resolved
+                std::vector<bool> _r;
+        };
+        
+        template <typename M> static ChrIndex<M> index(M &m) { return ChrIndex<M>(m); }
+        
+        /*
+         * Functor for parsing with multiple workers. The last argument is the index of the worker. The
+         * functor is called concurrently by different workers, but never concurrently by the same
+         * worker. Data and Info are only valid within the call.
+         */
+        
+        typedef std::function<void (Data &, const Info &, unsigned)> WFunctor;
+
+        // Number of threads requested by the user (--threads)
+        static unsigned threads();
+
         /*
          * In order to improve the efficiency, not everything is computed. Set the last
          * argument to true will force it to happen.
          */
 
         static void parse(const FileName &, Functor, bool details = false);
+        
+        /*
+         * Parse only the alignments overlapping the regions. This requires an index (.bai or .csi),
+         * every alignment is parsed if the index is not found. Returns true if the index was used.
+         */
+        
+        static bool parseRegions(const FileName &, const Chr2DInters &, Functor, bool details = false);
+
+        /*
+         * Number of mapped alignments recorded in the index, contigs without statistics count as zero.
+         * Returns false (the count is unchanged) if the index is not found or has no statistics (eg: CRAI).
+         */
+
+        static bool countMapped(const FileName &, Counts &);
+        
+        /*
+         * Whether the file has an index that is not older than the file. Only coordinate-sorted files can
+         * be indexed, thus the order of an indexed file can be trusted (unlike the header).
+         */
+        
+        static bool isIndexed(const FileName &);
+        
+        // Whether the header declares the sort order (eg: SO:coordinate or SO:queryname)
+        static bool isSorted(const FileName &, const std::string &order = "coordinate");
+        
+        /*
+         * Parse with a pool of workers. Alignments are decoded in blocks and dispatched to the
+         * workers, thus the order of the alignments is not preserved.
+         */
+        
+        static void parse(const FileName &, unsigned, WFunctor, bool details = false);
+        
+        /*
+         * Read the alignments once and give every alignment to all consumers, each consumer runs on
+         * its own thread and sees the alignments in the file order. The reader waits for the slowest
+         * consumer, thus memory is bounded.
+         */
+        
+        static void parse(const FileName &, const std::vector<Functor> &, bool details = false);
+        
+        /*
+         * Parse with a pool of workers, each accumulates into its own copy of the initial state.
+         * Copies are merged into the first copy once everything has been parsed.
+         */
+
+        template <typename T, typename F, typename M> static T parallel(const FileName &file,
+                                                                        const T &init,
+                                                                        F f,
+                                                                        M m,
+                                                                        bool details = false)
+        {
+            std::vector<T> x(threads(), init);
+            
+            parse(file, x.size(), [&](Data &d, const Info &i, unsigned w)
+            {
+                f(x[w], d, i);
+            }, details);
+            
+            for (auto i = 1; i < x.size(); i++)
+            {
+                m(x[0], x[i]);
+            }
+            
+            return x[0];
+        }
+
+        private:
+        
+            static void decode(Data &, Info &, void *, void *, bool);
     };
 }
 
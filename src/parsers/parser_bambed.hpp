@@ -27,9 +27,87 @@ namespace Anaquin
             SKIP_EVERYTHING
         };
         
+        /*
+         * Regions on a chromosome for sorted alignments. Regions are activated as the alignments reach
+         * them and finalized once the alignments have passed them, thus only the regions around the
+         * current position keep their coverage.
+         */
+        
+        struct Sweep
+        {
+            // Sorted by start
+            std::vector<DInter *> inters;
+            
+            // Regions that might overlap the current alignment (sorted by start)
+            std::vector<DInter *> active;
+            
+            // Next region to be activated
+            std::size_t next = 0;
+            
+            // Whether the alignments have passed the chromosome
+            bool done = false;
+            
+            inline DInter * overlap(const Locus &l)
+            {
+                while (next < inters.size() && inters[next]->l().start <= l.end)
+                {
+                    active.push_back(inters[next++]);
+                }
+                
+                // Finalize anything before the alignment, they won't be touched again
+                auto j = 0;
+                
+                for (auto i = 0; i < active.size(); i++)
+                {
+                    if (active[i]->l().end < l.start)
+                    {
+                        active[i]->finalize();
+                    }
+                    else
+                    {
+                        active[j++] = active[i];
+                    }
+                }
+                
+                active.resize(j);
+                
+                for (const auto &i : active)
+                {
+                    if (i->l().start <= l.end)
+                    {
+                        return i;
+                    }
+                }
+                
+                return nullptr;
+            }
+            
+            inline void finalize()
+            {
+                for (auto &i : inters)
+                {
+                    if (!i->finalized())
+                    {
+                        i->finalize();
+                    }
+                }
+                
+                active.clear();
+                done = true;
+            }
+        };
+        
+        /*
+         * Only alignments overlapping the regions are parsed if "fetch" is true and the alignment
+         * file is indexed. Coordinate-sorted alignments are swept without the interval trees, the
+         * order is only trusted for indexed files (the header alone might be wrong), other files
+         * are looked up in the interval trees.
+         */
+        
         template <typename F> static ParserBAMBED::Stats parse(const FileName &file,
                                                                const Chr2DInters &c2l,
-                                                               F f)
+                                                               F f,
+                                                               bool fetch = false)
         {
             ParserBAMBED::Stats stats;
 
@@ -48,13 +126,80 @@ namespace Anaquin
                 stats.inters[i.first].build();
             }
 
-            ParserBAM::parse(file, [&](ParserBAM::Data &x, const ParserBAM::Info &info)
+            // Only sorted files can be indexed
+            const auto sorted = ParserBAM::isSorted(file) && ParserBAM::isIndexed(file);
+            
+            std::map<ChrID, Sweep> sweeps;
+            
+            // Chromosome of the last alignment
+            int32_t tid = -1;
+            
+            // Sweep for the current chromosome
+            Sweep *sweep = nullptr;
+            
+            // Position of the last alignment
+            Base last = 0;
+            
+            if (sorted)
+            {
+                for (auto &i : stats.inters)
+                {
+                    auto &s = sweeps[i.first];
+                    
+                    for (const auto &j : i.second.data())
+                    {
+                        s.inters.push_back(i.second.find(j.first));
+                    }
+                    
+                    std::sort(s.inters.begin(), s.inters.end(), [&](const DInter *x, const DInter *y)
+                    {
+                        return x->l().start < y->l().start;
+                    });
+                }
+            }
+            
+            auto inters = ParserBAM::index(stats.inters);
+            
+            auto g = [&](ParserBAM::Data &x, const ParserBAM::Info &info)
             {
                 DInter *matched = nullptr;
                 
-                if (x.mapped && stats.inters.count(x.cID))
+                if (sorted && x.mapped)
                 {
-                    matched = stats.inters[x.cID].overlap(x.l);
+                    // New chromosome?
+                    if (x.tid != tid)
+                    {
+                        if (sweep)
+                        {
+                            sweep->finalize();
+                        }
+
+                        tid   = x.tid;
+                        sweep = sweeps.count(x.cID) ? &sweeps.at(x.cID) : nullptr;
+                        last  = 0;
+                        
+                        if (sweep && sweep->done)
+                        {
+                            throw std::runtime_error(file + " is not sorted by coordinates but indexed. " + x.cID + " is not contiguous. Please index the file again.");
+                        }
+                    }
+                    
+                    if (x.l.start < last)
+                    {
+                        throw std::runtime_error(file + " is not sorted by coordinates but indexed. Please index the file again.");
+                    }
+                    
+                    last = x.l.start;
+                    
+                    if (sweep)
+                    {
+                        matched = sweep->overlap(x.l);
+                    }
+                }
+                else if (x.mapped)
+                {
+                    const auto i = inters.find(x);
+                    matched = i ? i->overlap(x.l) : nullptr;
                 }
                 
                 const auto r = f(x, info, matched);
@@ -79,7 +224,24 @@ namespace Anaquin
                         stats.nNA++;
                     }
                 }
-            });
+            };
+            
+            if (fetch)
+            {
+                ParserBAM::parseRegions(file, c2l, g);
+            }
+            else
+            {
+                ParserBAM::parse(file, g);
+            }
+            
+            for (auto &i : sweeps)
+            {
+                if (!i.second.done)
+                {
+                    i.second.finalize();
+                }
+            }
             
             return stats;
         }
@@ -1,6 +1,12 @@
 #ifndef PARSER_GTF_HPP
 #define PARSER_GTF_HPP
 
+#include <cctype>
+#include <thread>
+#include <cstring>
+#include <exception>
+#include <htslib/bgzf.h>
+#include <boost/utility/string_ref.hpp>
 #include "data/tokens.hpp"
 #include "data/reader.hpp"
 #include "tools/tools.hpp"
@@ -8,42 +14,69 @@
 
 namespace Anaquin
 {
+    /*
+     * Parsing GTF files (plain, gzip or bgzip). Lines are tokenized in place, only the seqname, feature,
+     * positions, strand and the gene_id, transcript_id and FPKM attributes are extracted. Tokenizing
+     * can be shared by threads, the lines are read in large blocks and each block is split at line
+     * boundaries. The callback is always called in the order of the file.
+     */
+
     struct ParserGTF
     {
         struct Data
         {
             ChrID cID;
-            
+
             // Forward or reverse strand?
             Strand str;
-            
+
             // The location of the feature relative to the chromosome
             Locus l;
-            
+
             RNAFeature type;
-            
+
             // Empty if the information is unavailable
             GeneID gID;
-            
+
             // Empty if the information is unavailable
             TransID tID;
-            
+
             // Available only for Cufflink
             double fpkm = NAN;
         };
-        
-        template <typename F> static void parse(const Reader &r, F f)
+
+        // Fields for a line, referring to the line
+        struct Fields
+        {
+            boost::string_ref line, cID, gID, tID;
+
+            RNAFeature type;
+            Strand str;
+            Base start, end;
+            double fpkm;
+
+            // Number of lines before the line (in the block)
+            std::size_t i;
+        };
+
+        // Number of bytes read from the file at a time
+        static const std::size_t BLOCK_SIZE = 1 << 24;
+
+        // Remove Windows line endings and leading/trailing spaces, the same for memory and file input
+        static boost::string_ref trimLine(boost::string_ref line)
+        {
+            while (!line.empty() && isspace(static_cast<unsigned char>(line.back())))  { line.remove_suffix(1); }
+            while (!line.empty() && isspace(static_cast<unsigned char>(line.front()))) { line.remove_prefix(1); }
+            return line;
+        }
+
+        /*
+         * Tokenize a line. Returns false if the line is not for a known feature (eg: comment, CDS).
+         * File is only used for error messages.
+         */
+
+        static bool tokenize(boost::string_ref line, Fields &x, const std::string &file)
         {
-            std::map<std::string, RNAFeature> mapper =
-            {
-                { "exon",       RNAFeature::Exon },
-                { "gene",       RNAFeature::Gene },
-                { "transcript", RNAFeature::Transcript }
-            };
-            
-            std::string line;
-            Data x;
-            
             /*
              * Fields must be tab-separated. Also, all but the final field in each feature line must contain a value;
              * "empty" columns should be denoted with a '.'. Please refer to the online documentation for more details.
@@ -58,81 +91,400 @@ namespace Anaquin
              *    8. frame
              *    9. attribute
              */
-            
-            ParserProgress p;
-            
-            std::vector<std::string> opts;
-            std::vector<std::string> toks;
-            std::vector<std::string> nameVal;
-            
-            while (r.nextLine(line))
-            {
-                p.i++;
-                boost::split(toks, line, boost::is_any_of("\t"));
-                
-                // Empty line? Unknown feature such as mRNA?
-                if (toks.size() == 1 || !mapper.count(toks[2]))
+
+            if (line.empty() || line[0] == '#')
+            {
+                return false;
+            }
+
+            boost::string_ref toks[9];
+            auto n = 0;
+
+            for (auto p = line; n < 9; n++)
+            {
+                const auto i = n < 8 ? p.find('\t') : boost::string_ref::npos;
+
+                toks[n] = p.substr(0, i);
+
+                if (i == boost::string_ref::npos)
+                {
+                    n++;
+                    break;
+                }
+
+                p.remove_prefix(i + 1);
+            }
+
+            // Unknown feature such as mRNA?
+            if (n < 3)
+            {
+                return false;
+            }
+            else if (toks[2] == "exon")
+            {
+                x.type = RNAFeature::Exon;
+            }
+            else if (toks[2] == "gene")
+            {
+                x.type = RNAFeature::Gene;
+            }
+            else if (toks[2] == "transcript")
+            {
+                x.type = RNAFeature::Transcript;
+            }
+            else
+            {
+                return false;
+            }
+
+            if (n < 8)
+            {
+                throw std::runtime_error("File: " + file + ". Invalid line: " + line.to_string());
+            }
+
+            auto base = [&](boost::string_ref s)
+            {
+                Base b = 0;
+
+                for (const auto &c : s)
+                {
+                    if (c < '0' || c > '9')
+                    {
+                        throw std::runtime_error("File: " + file + ". Invalid position: [" + s.to_string() + "]. Line: " + line.to_string());
+                    }
+
+                    b = 10 * b + (c - '0');
+                }
+
+                if (s.empty())
+                {
+                    throw std::runtime_error("File: " + file + ". Empty position. Line: " + line.to_string());
+                }
+
+                return b;
+            };
+
+            x.line  = line;
+            x.cID   = toks[0];
+            x.start = base(toks[3]);
+            x.end   = base(toks[4]);
+
+            if (toks[6] == "+")
+            {
+                x.str = Strand::Forward;
+            }
+            else if (toks[6] == "-")
+            {
+                x.str = Strand::Backward;
+            }
+            else if (toks[6] == ".")
+            {
+                x.str = Strand::Either;
+            }
+            else
+            {
+                throw std::runtime_error("File: " + file + ". Invalid strand: [" + toks[6].to_string() + "]. Line: " + line.to_string());
+            }
+
+            x.gID  = x.tID = boost::string_ref();
+            x.fpkm = NAN;
+
+            /*
+             * Eg: "gene_id "R_5_3"; transcript_id "R_5_3_R";"
+             */
+
+            auto trim = [&](boost::string_ref s)
+            {
+                while (!s.empty() && s.front() == ' ') { s.remove_prefix(1); }
+                while (!s.empty() && s.back()  == ' ') { s.remove_suffix(1); }
+                return s;
+            };
+
+            for (auto attrs = n == 9 ? toks[8] : boost::string_ref(); !attrs.empty();)
+            {
+                const auto i = attrs.find(';');
+                const auto option = trim(attrs.substr(0, i));
+
+                attrs = i == boost::string_ref::npos ? boost::string_ref() : attrs.substr(i + 1);
+
+                const auto j = option.find(' ');
+
+                if (j == boost::string_ref::npos)
                 {
                     continue;
                 }
-                
-                x.cID  = toks[0];
-                x.type = mapper[toks[2]];
 
-                x.l.start = stoi(toks[3]);
-                x.l.end   = stoi(toks[4]);
+                const auto name = option.substr(0, j);
+                auto val = trim(option.substr(j + 1));
+
+                // Make sure the silly characters are removed
+                if (!val.empty() && val.front() == '\"') { val.remove_prefix(1); }
+                if (!val.empty() && val.back()  == '\"') { val.remove_suffix(1); }
 
-                if (toks[6] != "+" && toks[6] != "-" && toks[6] != ".")
+                if (name == "gene_id")
+                {
+                    x.gID = val;
+                }
+                else if (name == "transcript_id")
+                {
+                    x.tID = val;
+                }
+                else if (name == "FPKM")
                 {
-                    throw std::runtime_error("File: " + r.src() + ". Invalid strand: [" + toks[6] + "]. Line: " + line );
+                    x.fpkm = number(val);
                 }
+            }
+
+            return true;
+        }
 
-                if (toks[6] == ".")
+        /*
+         * Parse a GTF file, f is called with the data, the line and the progress for each feature.
+         * Lines are tokenized by the threads if more than one thread is given.
+         */
+
+        template <typename F> static void parse(const Reader &r, F f, unsigned threads = 1)
+        {
+            Data x;
+            ParserProgress p;
+
+            auto g = [&](const Fields &t)
+            {
+                x.cID.assign(t.cID.data(), t.cID.size());
+                x.gID.assign(t.gID.data(), t.gID.size());
+                x.tID.assign(t.tID.data(), t.tID.size());
+
+                x.type    = t.type;
+                x.str     = t.str;
+                x.l.start = t.start;
+                x.l.end   = t.end;
+                x.fpkm    = t.fpkm;
+
+                f(x, t.line, p);
+            };
+
+            // Memory input (eg: testing)
+            if (!r.isFile())
+            {
+                Fields t;
+                std::string line;
+
+                while (r.nextLine(line))
                 {
-                    x.str = Strand::Either;
+                    const auto l = trimLine(line);
+
+                    // Empty lines are not counted
+                    if (l.empty())
+                    {
+                        continue;
+                    }
+
+                    p.i++;
+
+                    if (tokenize(l, t, r.src()))
+                    {
+                        g(t);
+                    }
                 }
-                else
+
+                return;
+            }
+
+            const auto file = r.src();
+
+            // Tokenized lines by each thread
+            std::vector<std::vector<Fields>> ts(std::max(threads, 1u));
+
+            // Number of lines by each thread
+            std::vector<std::size_t> ns(ts.size());
+
+            // Tokenize the lines in [i, j)
+            auto work = [&](const char *i, const char *j, std::size_t k)
+            {
+                Fields t;
+
+                ts[k].clear();
+                ns[k] = 0;
+
+                while (i < j)
                 {
-                    x.str = toks[6] == "+" ? Strand::Forward : Strand::Backward;
+                    const auto *e = static_cast<const char *>(memchr(i, '\n', j - i));
+                    const auto line = trimLine(boost::string_ref(i, (e ? e : j) - i));
+
+                    i = e ? e + 1 : j;
+
+                    // Empty lines are not counted
+                    if (line.empty())
+                    {
+                        continue;
+                    }
+
+                    if (tokenize(line, t, file))
+                    {
+                        t.i = ns[k];
+                        ts[k].push_back(t);
+                    }
+
+                    ns[k]++;
                 }
+            };
 
-                /*
-                 * Eg: "gene_id "R_5_3"; transcript_id "R_5_3_R";"
-                 */
-                
-                boost::split(opts, toks[8], boost::is_any_of(";"));
-                
-                for (auto option : opts)
+            blocks(file, threads, [&](const char *i, const char *j)
+            {
+                if (ts.size() == 1)
                 {
-                    if (!option.empty())
+                    work(i, j, 0);
+                }
+                else
+                {
+                    std::vector<std::thread> workers;
+                    std::vector<std::exception_ptr> errs(ts.size());
+
+                    for (auto k = 0; k < ts.size(); k++)
                     {
-                        boost::trim(option);
-                        boost::split(nameVal, option, boost::is_any_of(" "));
-                        
-                        if (nameVal.size() == 2)
+                        // Split at the next line
+                        auto e = k == ts.size() - 1 ? j : i + (j - i) / (ts.size() - k);
+
+                        if (e < j)
                         {
-                            // Make sure the silly characters are removed
-                            nameVal[1].erase(std::remove(nameVal[1].begin(), nameVal[1].end(), '\"'), nameVal[1].end());
-                            
-                            if (nameVal[0] == "gene_id")
-                            {
-                                x.gID = nameVal[1];
-                            }
-                            else if (nameVal[0] == "transcript_id")
+                            const auto *n = static_cast<const char *>(memchr(e, '\n', j - e));
+                            e = n ? n + 1 : j;
+                        }
+
+                        workers.push_back(std::thread([&, i, e, k]()
+                        {
+                            try
                             {
-                                x.tID = nameVal[1];
+                                work(i, e, k);
                             }
-                            else if (nameVal[0] == "FPKM")
+                            catch (...)
                             {
-                                x.fpkm = s2d(nameVal[1]);
+                                errs[k] = std::current_exception();
                             }
+                        }));
+
+                        i = e;
+                    }
+
+                    for (auto &w : workers)
+                    {
+                        w.join();
+                    }
+
+                    for (const auto &e : errs)
+                    {
+                        if (e)
+                        {
+                            std::rethrow_exception(e);
                         }
                     }
                 }
 
-                f(x, line, p);
-            }            
+                for (auto k = 0; k < ts.size(); k++)
+                {
+                    const auto n = p.i;
+
+                    for (const auto &t : ts[k])
+                    {
+                        p.i = n + t.i + 1;
+                        g(t);
+                    }
+
+                    p.i = n + ns[k];
+                }
+            });
         }
+
+        private:
+
+            static double number(boost::string_ref x)
+            {
+                char buf[64];
+
+                // Long numbers are rare, don't bother
+                if (x.size() >= sizeof(buf))
+                {
+                    return s2d(x.to_string());
+                }
+
+                memcpy(buf, x.data(), x.size());
+                buf[x.size()] = '\0';
+
+                char *e;
+                const auto d = strtod(buf, &e);
+
+                return e == buf ? s2d(x.to_string()) : d;
+            }
+
+            /*
+             * Read a file in blocks of whole lines (except the last line might not end with a new line),
+             * gzip and bgzip are decompressed.
+             */
+
+            template <typename G> static void blocks(const FileName &file, unsigned threads, G g)
+            {
+                auto *fp = bgzf_open(file.c_str(), "r");
+
+                if (!fp)
+                {
+                    throw std::runtime_error("Failed to open: " + file);
+                }
+
+                std::shared_ptr<BGZF> x(fp, [](BGZF *fp) { bgzf_close(fp); });
+
+                if (threads > 1 && bgzf_compression(fp) == 2)
+                {
+                    bgzf_mt(fp, threads, 256);
+                }
+
+                std::vector<char> buf(BLOCK_SIZE);
+
+                // Bytes of the incomplete line from the last block
+                std::size_t n = 0;
+
+                for (;;)
+                {
+                    // A line longer than the block?
+                    if (n == buf.size())
+                    {
+                        buf.resize(2 * buf.size());
+                    }
+
+                    const auto k = bgzf_read(fp, &buf[n], buf.size() - n);
+
+                    if (k < 0)
+                    {
+                        throw std::runtime_error("Failed to read: " + file);
+                    }
+                    else if (!k)
+                    {
+                        if (n)
+                        {
+                            g(buf.data(), buf.data() + n);
+                        }
+
+                        break;
+                    }
+
+                    const auto m = n + k;
+
+                    // End of the last whole line
+                    auto e = m;
+
+                    while (e && buf[e-1] != '\n')
+                    {
+                        e--;
+                    }
+
+                    if (e)
+                    {
+                        g(buf.data(), buf.data() + e);
+                    }
+
+                    n = m - e;
+                    memmove(buf.data(), buf.data() + e, n);
+                }
+            }
     };
 }
 
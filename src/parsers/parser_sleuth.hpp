@@ -78,7 +78,7 @@ namespace Anaquin
                     t.iID = toks[Field::TargetID];
                     
                     // Can we match the isoform to sequins?
-                    auto isChrIS = ref.seqsL1().count(t.iID);
+                    auto isChrIS = ref.isSeqL1(t.iID);
                     
                     t.cID = isChrIS ? ChrIS() : "geno";
                     t.gID = ""; // TODO: isChrIS ? ref.s2g(t.iID) : "";
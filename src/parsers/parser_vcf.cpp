@@ -1,180 +1,365 @@
 #include <stdio.h>
+#include <string.h>
 #include <stdlib.h>
 #include "htslib/hts.h"
 #include "htslib/vcf.h"
+#include "htslib/tbx.h"
 #include "parsers/parser_vcf.hpp"
 
 using namespace Anaquin;
 
-void ParserVCF::parse(const Reader &r, Functor f)
+// Must match VCFInfo
+static const char *Infos[] =
 {
-    htsFile *fp = bcf_open(r.src().c_str(), "r");
-    
-    if (!fp)
+    "CS", "CX", "GN", "GT", "AF", "CP", "DP", "SVLEN", "QSI", "QSS", "SomaticEVS"
+};
+
+// Must match VCFFormat
+static const char *Formats[] =
+{
+    "GT", "AD", "AF", "DP", "TAR", "TIR", "AU", "CU", "GU", "TU"
+};
+
+static const auto NInfos   = static_cast<unsigned>(VCFInfo::Count);
+static const auto NFormats = static_cast<unsigned>(VCFFormat::Count);
+
+static_assert(sizeof(Infos)   / sizeof(Infos[0])   == NInfos,   "Infos doesn't match VCFInfo");
+static_assert(sizeof(Formats) / sizeof(Formats[0]) == NFormats, "Formats doesn't match VCFFormat");
+
+// Read the i-th value of a typed BCF array, returns false if missing
+static inline bool value(int type, const uint8_t *p, int i, double &x)
+{
+    switch (type)
     {
-        throw std::runtime_error("Failed to open: " + r.src());
+        case BCF_BT_INT8:
+        {
+            const auto v = reinterpret_cast<const int8_t *>(p)[i];
+            x = v;
+            return v != bcf_int8_missing && v != bcf_int8_vector_end;
+        }
+
+        case BCF_BT_INT16:
+        {
+            int16_t v;
+            memcpy(&v, p + i * sizeof(v), sizeof(v));
+            x = v;
+            return v != bcf_int16_missing && v != bcf_int16_vector_end;
+        }
+
+        case BCF_BT_INT32:
+        {
+            int32_t v;
+            memcpy(&v, p + i * sizeof(v), sizeof(v));
+            x = v;
+            return v != bcf_int32_missing && v != bcf_int32_vector_end;
+        }
+
+        case BCF_BT_FLOAT:
+        {
+            float v;
+            memcpy(&v, p + i * sizeof(v), sizeof(v));
+            x = v;
+            return !bcf_float_is_missing(v) && !bcf_float_is_vector_end(v);
+        }
+
+        default: { return false; }
     }
-    
-    bcf_hdr_t *hdr = bcf_hdr_read(fp);
+}
 
-    if (!hdr)
+// Header IDs of the required fields, resolved once for a file
+struct Schema
+{
+    Schema(const bcf_hdr_t *hdr, const ParserVCF::Fields &fields)
     {
-        throw std::runtime_error("Failed to open: " + r.src());
+        for (auto i = 0u; i < NInfos; i++)
+        {
+            iIDs[i] = (fields.info & (1u << i)) ? bcf_hdr_id2int(hdr, BCF_DT_ID, Infos[i]) : -1;
+            unpack |= iIDs[i] >= 0 ? BCF_UN_INFO : 0;
+        }
+        
+        for (auto i = 0u; i < NFormats; i++)
+        {
+            fIDs[i] = (fields.format & (1u << i)) ? bcf_hdr_id2int(hdr, BCF_DT_ID, Formats[i]) : -1;
+            unpack |= fIDs[i] >= 0 ? BCF_UN_FMT : 0;
+        }
     }
+    
+    // Negative if not required or not in the header
+    int iIDs[NInfos], fIDs[NFormats];
+    
+    int unpack = BCF_UN_STR | BCF_UN_FLT;
+};
 
-    int c;
+// Decode a record, returns false if there is no alternative allele
+static bool decode(Variant &x, bcf_hdr_t *hdr, bcf1_t *line, const Schema &schema)
+{
     char pass[] = "PASS";
 
-    char  *ps = (char  *) malloc(1024 * sizeof(int));
-    int   *pi = (int *)   malloc(1024 * sizeof(int));
-    float *pf = (float *) malloc(1024 * sizeof(float));
+    bcf_unpack(line, schema.unpack);
     
-    bcf1_t *line = bcf_init();
+    x.cID  = chrom(std::string(bcf_seqname(hdr, line)));
+    x.name = line->d.id;
     
-    while (bcf_read(fp, hdr, line) == 0)
+    x.l.start = x.l.end = line->pos;
+    
+    x.ref    = std::string(line->d.allele[0]);
+    x.alt    = line->n_allele > 1 ? std::string(line->d.allele[1]) : "";
+    x.qual   = line->qual;
+    x.filter = (bcf_has_filter(hdr, line, pass) == 1) ? Filter::Pass : Filter::NotFilted;
+
+    if (x.alt == "." || x.alt == "")
     {
-        Variant x;
-        
-        bcf_unpack(line, BCF_UN_ALL);
+        return false;
+    }
+    
+    for (auto i = 0u; i < NInfos; i++)
+    {
+        const bcf_info_t *p = schema.iIDs[i] >= 0 ? bcf_get_info_id(line, schema.iIDs[i]) : nullptr;
         
-        x.cID  = chrom(std::string(bcf_seqname(hdr, line)));
-        x.name = line->d.id;
+        // Flags have no value
+        if (!p || !p->vptr || p->len <= 0)
+        {
+            continue;
+        }
+        else if (p->type == BCF_BT_CHAR)
+        {
+            const auto s = reinterpret_cast<const char *>(p->vptr);
+            x._is[i].assign(s, strnlen(s, p->len));
+            x._info |= 1u << i;
+        }
+        else if (value(p->type, p->vptr, 0, x._iv[i]))
+        {
+            x._info |= 1u << i;
+        }
+    }
+    
+    x.allF  = x.info(VCFInfo::AF);
+    x.depth = x.info(VCFInfo::DP);
+    
+    const auto n = line->n_sample;
+    
+    // FORMAT fields in the record
+    const bcf_fmt_t *fmts[NFormats];
+    
+    auto total = 0u;
+
+    for (auto i = 0u; i < NFormats; i++)
+    {
+        fmts[i] = schema.fIDs[i] >= 0 ? bcf_get_fmt_id(line, schema.fIDs[i]) : nullptr;
+        total  += fmts[i] && fmts[i]->p ? fmts[i]->n * n : 0;
+    }
+    
+    x._fv.reserve(total);
+    
+    for (auto i = 0u; i < NFormats; i++)
+    {
+        const auto *p = fmts[i];
         
-        x.l.start = x.l.end = line->pos;
+        x._fo[i] = x._fv.size();
         
-        x.ref    =  std::string(line->d.allele[0]);
-        x.alt    =  std::string(line->d.allele[1]);
-        x.qual   = line->qual;
-        x.filter = (bcf_has_filter(hdr, line, pass) == 1) ? Filter::Pass : Filter::NotFilted;
-
-        if (x.alt == "." || x.alt == "")
+        if (!p || !p->p)
         {
             continue;
         }
         
-        auto infos = [&](const std::string &key)
+        x._fn[i] = p->n;
+        
+        for (auto s = 0u; s < n; s++)
         {
-            if (bcf_get_info_string(hdr, line, key.c_str(), &ps, &c) > 0)
+            for (auto j = 0; j < p->n; j++)
             {
-                x.ifs[key] = ps;
+                double v;
+                x._fv.push_back(value(p->type, p->p + s * p->size, j, v) ? v : NAN);
             }
-        };
+        }
+    }
+    
+    x._fo[NFormats] = x._fv.size();
+    
+    // Only for diploid single sample
+    if (fmts[static_cast<unsigned>(VCFFormat::GT)] && x._fn[static_cast<unsigned>(VCFFormat::GT)] * n == 2)
+    {
+        const auto i = x._fo[static_cast<unsigned>(VCFFormat::GT)];
         
-        auto infof = [&](const std::string &key)
+        if (!std::isnan(x._fv[i]) && !std::isnan(x._fv[i+1]))
         {
-            if (bcf_get_info_float(hdr, line, key.c_str(), &pf, &c) > 0)
-            {
-                x.iff[key] = *pf;
-            }
-        };
+            const auto a1 = bcf_gt_allele(static_cast<int>(x._fv[i]));
+            const auto a2 = bcf_gt_allele(static_cast<int>(x._fv[i+1]));
+            
+            x.gt = a1 == a2 ? Genotype::Homozygous : Genotype::Heterzygous;
+        }
+    }
 
-        auto infoi = [&](const std::string &key)
-        {
-            if (bcf_get_info_int32(hdr, line, key.c_str(), &pi, &c) > 0)
-            {
-                x.ifi[key] = *pi;
-            }
-        };
-        
-        infos("CS");
-        infos("CX");
-        infos("GN");
-        infos("GT");
-        infof("AF");
-        infof("CP");
-        infoi("DP");
-        infoi("SVLEN");
+    if (fmts[static_cast<unsigned>(VCFFormat::AD)] && x._fn[static_cast<unsigned>(VCFFormat::AD)] * n == 2)
+    {
+        // Missing depths (NAN) can't be converted to counts
+        if (x.hasFormat(VCFFormat::AD, 0, 0)) { x.readR = x.format(VCFFormat::AD, 0, 0); }
+        if (x.hasFormat(VCFFormat::AD, 0, 1)) { x.readV = x.format(VCFFormat::AD, 0, 1); }
+    }
+
+    x.hdr  = (void *) hdr;
+    x.line = (void *) line;
+    
+    return true;
+}
+
+void ParserVCF::parse(const Reader &r, Functor f, const Fields &fields)
+{
+    htsFile *fp = bcf_open(r.src().c_str(), "r");
+    
+    if (!fp)
+    {
+        throw std::runtime_error("Failed to open: " + r.src());
+    }
+    
+    bcf_hdr_t *hdr = bcf_hdr_read(fp);
+
+    if (!hdr)
+    {
+        throw std::runtime_error("Failed to open: " + r.src());
+    }
+
+    const Schema schema(hdr, fields);
+    
+    bcf1_t *line = bcf_init();
+    
+    while (bcf_read(fp, hdr, line) == 0)
+    {
+        Variant x;
         
-        infoi("QSI");        // Strelka
-        infoi("QSS");        // Strelka
-        infof("SomaticEVS"); // Strelka
+        if (decode(x, hdr, line, schema))
+        {
+            f(x);
+        }
+    }
+    
+    bcf_destroy(line);
+    bcf_hdr_destroy(hdr);
+    hts_close(fp);
+}
+
+bool ParserVCF::parseRegions(const Reader &r, const Chr2DInters &regs, Functor f, const Fields &fields)
+{
+    htsFile *fp = bcf_open(r.src().c_str(), "r");
+    
+    if (!fp)
+    {
+        throw std::runtime_error("Failed to open: " + r.src());
+    }
+    
+    bcf_hdr_t *hdr = bcf_hdr_read(fp);
+    
+    if (!hdr)
+    {
+        throw std::runtime_error("Failed to open: " + r.src());
+    }
+
+    // CSI for BCF, tabix (or CSI) for compressed VCF
+    const auto isBCF = hts_get_format(fp)->format == bcf;
+
+    hts_idx_t *idx = isBCF ? bcf_index_load(r.src().c_str()) : nullptr;
+    tbx_t     *tbx = isBCF ? nullptr : tbx_index_load(r.src().c_str());
+    
+    if (!idx && !tbx)
+    {
+        bcf_hdr_destroy(hdr);
+        hts_close(fp);
         
-        if (x.iff.count("AF")) { x.allF  = x.iff.at("AF"); }
-        if (x.ifi.count("DP")) { x.depth = x.ifi.at("DP"); }
+        // Nothing we can do without the index
+        parse(r, f, fields);
         
-        int32_t *g1 = NULL, g2 = 0;
-        if (bcf_get_genotypes(hdr, line, &g1, &g2) == 2)
+        return false;
+    }
+    
+    // Sequences in the index, by their standardized names
+    std::map<ChrID, int> tids;
+    
+    int n;
+    const char **names = isBCF ? bcf_hdr_seqnames(hdr, &n) : tbx_seqnames(tbx, &n);
+    
+    for (auto i = 0; i < n; i++)
+    {
+        tids[chrom(std::string(names[i]))] = i;
+    }
+    
+    free(names);
+    
+    const Schema schema(hdr, fields);
+    
+    bcf1_t *line = bcf_init();
+    kstring_t str = { 0, 0, nullptr };
+    
+    // For each chromosome...
+    for (const auto &i : regs)
+    {
+        // Chromosome not in the index?
+        if (!tids.count(i.first))
         {
-            x.gt = g1[0] == g1[1] ? Genotype::Homozygous : Genotype::Heterzygous;
-            free(g1);
+            continue;
         }
-
-        int32_t *a1 = NULL, a2 = 0;
-        if (bcf_get_format_int32(hdr, line, "AD", &a1, &a2) == 2)
+        
+        const auto tid = tids.at(i.first);
+        
+        std::vector<Locus> loci;
+        
+        for (const auto &j : i.second.data())
         {
-            x.readR = a1[0];
-            x.readV = a1[1];
-            free(a1);
+            loci.push_back(j.second.l());
         }
         
-        auto fi = [&](const std::string &key, const std::string &to, int i)
+        // Last position (zero-based) covered by the previous query
+        Base last = -1;
+        
+        // Merged regions are sorted and not overlapping
+        for (const auto &l : Locus::merge<Locus, Locus>(loci))
         {
-            if (bcf_get_format_int32(hdr, line, key.c_str(), &pi, &c) > i)
+            /*
+             * Zero-based and half-open. Variant positions are zero-based, thus one more base is
+             * queried on the right for variants at the last base of the region.
+             */
+            
+            auto iter = isBCF ? bcf_itr_queryi(idx, tid, l.start - 1, l.end + 1) :
+                                tbx_itr_queryi(tbx, tid, l.start - 1, l.end + 1);
+            
+            if (!iter)
             {
-                x.fi[to] = *(pi+i);
+                throw std::runtime_error("Failed to query " + i.first + " in " + r.src());
             }
-        };
-
-        auto ff = [&](const std::string &key, const std::string &to, int i)
-        {
-            if (bcf_get_format_float(hdr, line, key.c_str(), &pf, &c) > i)
+            
+            while ((isBCF ? bcf_itr_next(fp, iter, line) : tbx_itr_next(fp, tbx, iter, &str)) >= 0)
             {
-                x.ff[to] = *(pf+i);
+                if (!isBCF && vcf_parse(&str, hdr, line) < 0)
+                {
+                    throw std::runtime_error("Failed to parse " + r.src());
+                }
+                
+                // Spanning the previous region? It has already been parsed.
+                if (line->pos <= last)
+                {
+                    continue;
+                }
+                
+                Variant x;
+                
+                if (decode(x, hdr, line, schema))
+                {
+                    f(x);
+                }
             }
-        };
-
-        fi("TAR", "TAR_1_1", 0);
-        fi("TAR", "TAR_1_2", 1);
-        fi("TAR", "TAR_2_1", 2);
-        fi("TAR", "TAR_2_2", 3);
-        
-        fi("TIR", "TIR_1_1", 0);
-        fi("TIR", "TIR_1_2", 1);
-        fi("TIR", "TIR_2_1", 2);
-        fi("TIR", "TIR_2_2", 3);
-
-        fi("DP", "DP_1", 0);
-        fi("DP", "DP_2", 1);
-        ff("AF", "AF_1", 0);
-        ff("AF", "AF_2", 1);
-        
-        fi("AU", "AU_1_1", 0);
-        fi("AU", "AU_1_2", 1);
-        fi("AU", "AU_2_1", 2); // Tumor Tier-1
-        fi("AU", "AU_2_2", 3);
-        fi("CU", "CU_1_1", 0);
-        fi("CU", "CU_1_2", 1);
-        fi("CU", "CU_2_1", 2); // Tumor Tier-1
-        fi("CU", "CU_2_2", 3);
-        fi("GU", "GU_1_1", 0);
-        fi("GU", "GU_1_2", 1);
-        fi("GU", "GU_2_1", 2); // Tumor Tier-1
-        fi("GU", "GU_2_2", 3);
-        fi("TU", "TU_1_1", 0);
-        fi("TU", "TU_1_2", 1);
-        fi("TU", "TU_2_1", 2); // Tumor Tier-1
-        fi("TU", "TU_2_2", 3);
-
-        /*
-         * Eg: "AD_1_1" -> first value in the first sample
-         *     "AD_2_1" -> firsr value in the second sample
-         *
-         * Note that we assume the sample is diploid.
-         */
-        
-        fi("AD", "AD_1_1", 0);
-        fi("AD", "AD_1_2", 1);
-        fi("AD", "AD_2_1", 2);
-        fi("AD", "AD_2_2", 3);
-
-        x.hdr  = (void *) hdr;
-        x.line = (void *) line;
-        
-        f(x);
+            
+            hts_itr_destroy(iter);
+            last = l.end;
+        }
     }
     
-    free(ps);
-    free(pi);
-    free(pf);
+    free(str.s);
+    
+    if (idx) { hts_idx_destroy(idx); }
+    if (tbx) { tbx_destroy(tbx);     }
+
+    bcf_destroy(line);
+    bcf_hdr_destroy(hdr);
     hts_close(fp);
+    
+    return true;
 }
@@ -1,7 +1,9 @@
 #ifndef PARSER_VCF_HPP
 #define PARSER_VCF_HPP
 
+#include <initializer_list>
 #include "data/reader.hpp"
+#include "data/dinters.hpp"
 #include "data/variant.hpp"
 
 namespace Anaquin
@@ -9,7 +11,42 @@ namespace Anaquin
     struct ParserVCF
     {
         typedef std::function<void (Variant &)> Functor;
-        static void parse(const Reader &r, Functor f);
+        
+        /*
+         * INFO and FORMAT fields required by a tool. Fields not required are never decoded, INFO
+         * and FORMAT aren't unpacked if nothing is required from them.
+         */
+        
+        struct Fields
+        {
+            Fields(std::initializer_list<VCFInfo> i = {}, std::initializer_list<VCFFormat> f = {})
+            {
+                for (const auto &x : i) { info   |= 1u << static_cast<unsigned>(x); }
+                for (const auto &x : f) { format |= 1u << static_cast<unsigned>(x); }
+            }
+            
+            static inline Fields all()
+            {
+                Fields x;
+                x.info = x.format = ~0u;
+                return x;
+            }
+            
+            // Required fields (bitwise)
+            unsigned info = 0, format = 0;
+        };
+        
+        static void parse(const Reader &r, Functor f, const Fields &fields = Fields::all());
+        
+        /*
+         * Parse only the variants overlapping the regions. This requires an index (.tbi or .csi),
+         * every variant is parsed if the index is not found. Returns true if the index was used.
+         */
+        
+        static bool parseRegions(const Reader &r,
+                                 const Chr2DInters &regs,
+                                 Functor f,
+                                 const Fields &fields = Fields::all());
     };
 }
 
@@ -2,6 +2,7 @@
 #define ANALYZER_HPP
 
 #include <map>
+#include <mutex>
 #include <memory>
 #include <numeric>
 #include <sstream>
@@ -97,12 +98,14 @@ namespace Anaquin
 
         inline void warn(const std::string &s) const
         {
+            std::lock_guard<std::recursive_mutex> lock(logMutex());
             logger->write("[WARN]: " + s);
             output->write("[WARN]: " + s);
         }
         
         inline void wait(const std::string &s) const
         {
+            std::lock_guard<std::recursive_mutex> lock(logMutex());
             logger->write("[WAIT]: " + s);
             output->write("[WAIT]: " + s);
         }
@@ -119,6 +122,7 @@ namespace Anaquin
         
         inline void info(const std::string &s) const
         {
+            std::lock_guard<std::recursive_mutex> lock(logMutex());
             logInfo(s);
             
             if (__showInfo__)
@@ -129,27 +133,42 @@ namespace Anaquin
         
         inline void logInfo(const std::string &s) const
         {
+            std::lock_guard<std::recursive_mutex> lock(logMutex());
             logger->write("[INFO]: " + s);
         }
         
         inline void logWarn(const std::string &s) const
         {
+            std::lock_guard<std::recursive_mutex> lock(logMutex());
             logger->write("[WARN]: " + s);
         }
 
         inline void logWait(const std::string &s) const
         {
+            std::lock_guard<std::recursive_mutex> lock(logMutex());
             logger->write("[WAIT]: " + s);
         }
         
         inline void error(const std::string &s) const
         {
+            std::lock_guard<std::recursive_mutex> lock(logMutex());
             logger->write("[ERROR]: " + s);
             output->write("[ERROR]: " + s);
         }
         
         // Write to the standard terminal
-        inline void out(const std::string &s) const { output->write(s); }
+        inline void out(const std::string &s) const
+        {
+            std::lock_guard<std::recursive_mutex> lock(logMutex());
+            output->write(s);
+        }
+        
+        // Logging is shared by threads analyzing different files
+        static std::recursive_mutex &logMutex()
+        {
+            static std::recursive_mutex m;
+            return m;
+        }
     };
 
     struct AnalyzerOptions : public WriterOptions
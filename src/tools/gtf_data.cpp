@@ -0,0 +1,596 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <numeric>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <unordered_map>
+#include "tools/gtf_data.hpp"
+
+// Defined in main.cpp
+extern unsigned __threads__;
+
+using namespace Anaquin;
+
+#define MIN_INTRON_LEN 4
+
+// Bump for any change in the snapshot layout
+static const std::uint32_t VERSION = 2;
+
+static const char MAGIC[8] = { 'A', 'Q', 'G', 'T', 'F', 'I', 'D', 'X' };
+
+// Offsets of the sections in a snapshot
+struct Layout
+{
+    std::size_t chrs, genes, trans, exons, intrs, offs, chars, size;
+};
+
+template <typename H> static Layout layout(const H &h)
+{
+    Layout l;
+
+    l.chrs  = sizeof(H);
+    l.genes = l.chrs  + h.nChrs  * sizeof(GTFData::Chr);
+    l.trans = l.genes + h.nGenes * sizeof(GTFData::Gene);
+    l.exons = l.trans + h.nTrans * sizeof(GTFData::Trans);
+    l.intrs = l.exons + h.nExons * sizeof(GTFData::Feature);
+    l.offs  = l.intrs + h.nIntrs * sizeof(GTFData::Feature);
+    l.chars = l.offs  + (h.nNames + 1) * sizeof(std::uint64_t);
+    l.size  = l.chars + h.nChars;
+
+    return l;
+}
+
+// FNV-1a, stable across runs (unlike std::hash)
+static std::uint64_t fnv(const char *x, std::size_t n, std::uint64_t h = 14695981039346656037ULL)
+{
+    for (std::size_t i = 0; i < n; i++)
+    {
+        h = (h ^ static_cast<unsigned char>(x[i])) * 1099511628211ULL;
+    }
+
+    return h;
+}
+
+static std::uint64_t hashPath(const FileName &file)
+{
+    char buf[PATH_MAX];
+    const std::string x = realpath(file.c_str(), buf) ? buf : file;
+    return fnv(x.data(), x.size());
+}
+
+// Size of the blocks hashed at the beginning and the end of a file
+#define HASH_BLOCK 65536
+
+// Hash of the first and last blocks, catches a rewrite that keeps the size and modification time
+static bool hashContent(const FileName &file, std::uint64_t size, std::uint64_t &h)
+{
+    const auto fd = open(file.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    std::vector<char> buf(HASH_BLOCK);
+
+    auto block = [&](std::uint64_t off)
+    {
+        const auto n = std::min<std::uint64_t>(HASH_BLOCK, size - off);
+        std::size_t k = 0;
+
+        while (k < n)
+        {
+            const auto r = pread(fd, buf.data() + k, n - k, off + k);
+
+            if (r <= 0)
+            {
+                return false;
+            }
+
+            k += r;
+        }
+
+        h = fnv(buf.data(), n, h);
+        return true;
+    };
+
+    h = 14695981039346656037ULL;
+    const auto r = block(0) && (size <= HASH_BLOCK || block(std::max<std::uint64_t>(HASH_BLOCK, size - HASH_BLOCK)));
+    close(fd);
+
+    return r;
+}
+
+FileName GTFData::snapshot(const FileName &file, const Path &cache)
+{
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hashPath(file)));
+
+    const auto i = file.find_last_of('/');
+    return cache + "/" + (i == std::string::npos ? file : file.substr(i + 1)) + "." + hex + ".anaquin.idx";
+}
+
+GTFData::GTFData(std::shared_ptr<const char> buf, bool mapped) : _buf(buf), _mapped(mapped)
+{
+    const auto *p = _buf.get();
+
+    _h = reinterpret_cast<const Header *>(p);
+
+    const auto l = layout(*_h);
+
+    _chrs  = reinterpret_cast<const Chr *>(p + l.chrs);
+    _genes = reinterpret_cast<const Gene *>(p + l.genes);
+    _trans = reinterpret_cast<const Trans *>(p + l.trans);
+    _exons = reinterpret_cast<const Feature *>(p + l.exons);
+    _intrs = reinterpret_cast<const Feature *>(p + l.intrs);
+    _offs  = reinterpret_cast<const std::uint64_t *>(p + l.offs);
+    _chars = p + l.chars;
+}
+
+struct GTFData::Builder
+{
+    // Gene, transcript or exon record (only the fields for the feature are used)
+    struct Record
+    {
+        NameID cID, tID, gID;
+        std::uint32_t str;
+        Base start, end;
+
+        // Order in the file
+        std::size_t i;
+    };
+
+    inline NameID intern(const std::string &x)
+    {
+        const auto i = ids.find(x);
+
+        if (i != ids.end())
+        {
+            return i->second;
+        }
+
+        names.push_back(x);
+        return (ids[x] = names.size() - 1);
+    }
+
+    void parse(const Reader &r)
+    {
+        std::size_t n = 0;
+
+        ParserGTF::parse(r, [&](const ParserGTF::Data &x, boost::string_ref, const ParserProgress &)
+        {
+            std::vector<Record> *recs;
+
+            switch (x.type)
+            {
+                case RNAFeature::Gene:       { recs = &genes; break; }
+                case RNAFeature::Exon:       { recs = &exons; break; }
+                case RNAFeature::Transcript: { recs = &trans; break; }
+
+                // Eg: CDS
+                default: { return; }
+            }
+
+            recs->push_back(Record { intern(x.cID), intern(x.tID), intern(x.gID), static_cast<std::uint32_t>(x.str),
+                                     x.l.start, x.l.end, n++ });
+        }, __threads__);
+    }
+
+    // Renumber the names in sorted order, comparing positions is then comparing names
+    void sortNames()
+    {
+        std::vector<NameID> order(names.size());
+        std::iota(order.begin(), order.end(), 0);
+
+        std::sort(order.begin(), order.end(), [&](NameID i, NameID j)
+        {
+            return names[i] < names[j];
+        });
+
+        std::vector<NameID> rank(names.size());
+        std::vector<std::string> sorted(names.size());
+
+        for (NameID i = 0; i < order.size(); i++)
+        {
+            rank[order[i]] = i;
+            sorted[i] = std::move(names[order[i]]);
+        }
+
+        names = std::move(sorted);
+        ids.clear();
+
+        for (auto *recs : { &genes, &trans, &exons })
+        {
+            for (auto &i : *recs)
+            {
+                i.cID = rank[i.cID];
+                i.tID = rank[i.tID];
+                i.gID = rank[i.gID];
+            }
+        }
+    }
+
+    /*
+     * Keep the last record for each key (eg: a gene declared twice), the records are sorted by the
+     * keys.
+     */
+
+    template <typename K> static void keepLast(std::vector<Record> &x, K key)
+    {
+        std::stable_sort(x.begin(), x.end(), [&](const Record &a, const Record &b)
+        {
+            return key(a) < key(b);
+        });
+
+        std::vector<Record> r;
+
+        for (auto i = 0; i < x.size(); i++)
+        {
+            if (i + 1 == x.size() || key(x[i]) != key(x[i+1]))
+            {
+                r.push_back(x[i]);
+            }
+        }
+
+        x = std::move(r);
+    }
+
+    // Keep the first record (in the file) for each key, the records are sorted by the keys
+    template <typename K> static void keepFirst(std::vector<Record> &x, K key)
+    {
+        std::sort(x.begin(), x.end(), [&](const Record &a, const Record &b)
+        {
+            return key(a) < key(b) || (key(a) == key(b) && a.i < b.i);
+        });
+
+        x.erase(std::unique(x.begin(), x.end(), [&](const Record &a, const Record &b)
+        {
+            return key(a) == key(b);
+        }), x.end());
+    }
+
+    // Gene for a transcript, the gene of the feature if the transcript is unknown
+    inline NameID t2g(const Record &x) const
+    {
+        const auto i = std::lower_bound(trans.begin(), trans.end(), x, [&](const Record &a, const Record &b)
+        {
+            return a.cID < b.cID || (a.cID == b.cID && a.tID < b.tID);
+        });
+
+        return i != trans.end() && i->cID == x.cID && i->tID == x.tID ? i->gID : x.gID;
+    }
+
+    std::shared_ptr<const char> build(const Header &key)
+    {
+        sortNames();
+
+        typedef std::tuple<NameID, NameID> Key2;
+        typedef std::tuple<NameID, NameID, Base, Base> Key4;
+
+        /*
+         * Genes and transcripts, the last record wins. Genes for a chromosome are counted by the
+         * transcript records.
+         */
+
+        std::set<Key2> gIDs;
+
+        for (const auto &i : trans)
+        {
+            gIDs.insert(Key2(i.cID, i.gID));
+        }
+
+        keepLast(genes, [&](const Record &x) { return Key2(x.cID, x.gID); });
+        keepLast(trans, [&](const Record &x) { return Key2(x.cID, x.tID); });
+
+        // Unique exons (due to alternative splicing), the first exon in the file for a locus and strand
+        auto uexons = exons;
+        keepFirst(uexons, [&](const Record &x) { return std::make_tuple(x.cID, x.str, x.start, x.end); });
+
+        // Exons for each transcript, the first exon for a locus
+        keepFirst(exons, [&](const Record &x) { return Key4(x.cID, x.tID, x.start, x.end); });
+
+        /*
+         * The information we have is sufficient for exons, transcripts and genes. We just
+         * need to compute introns, only possible once the exons are sorted.
+         */
+
+        std::vector<Record> intrs;
+
+        for (auto i = 0; i < exons.size();)
+        {
+            auto j = i + 1;
+
+            for (; j < exons.size() && exons[j].cID == exons[i].cID && exons[j].tID == exons[i].tID; j++) {}
+
+            /*
+             * -------------------------------------- Cufflinks Bug --------------------------------------
+             *
+             * It's possible for Cufflink guided assembly to give a transcript in both forward and backward
+             * strand. An example is in "cufflink_bug.png" in the source distribution. Clearly invalid,
+             * and thus we'll ignore the transcript.
+             */
+
+            bool shouldSkip = false;
+
+            for (auto k = i + 1; k < j && !shouldSkip; k++)
+            {
+                if (exons[k-1].str != exons[k].str)
+                {
+                    printWarning(names[exons[i].tID] + " gives transcription in both forward and backward strand. Ignored.");
+                    shouldSkip = true;
+                }
+            }
+
+            for (auto k = i + 1; k < j && !shouldSkip; k++)
+            {
+                // Intron spans between exons
+                auto x = exons[k-1];
+
+                x.start = exons[k-1].end + 1;
+                x.end   = exons[k].start - 1;
+                x.i     = intrs.size();
+
+                if (isChrIS(names[x.cID]) || Locus(x.start, x.end).length() >= MIN_INTRON_LEN)
+                {
+                    intrs.push_back(x);
+                }
+            }
+
+            i = j;
+        }
+
+        // Unique introns, the first transcript for a locus
+        keepFirst(intrs, [&](const Record &x) { return std::make_tuple(x.cID, x.start, x.end); });
+
+        std::map<NameID, std::uint32_t> nUExon;
+
+        for (const auto &i : uexons)
+        {
+            nUExon[i.cID]++;
+        }
+
+        // Exons in the opposite strands at the same locus are counted but kept once for a transcript
+        keepFirst(uexons, [&](const Record &x) { return Key4(x.cID, x.tID, x.start, x.end); });
+
+        std::sort(intrs.begin(), intrs.end(), [&](const Record &a, const Record &b)
+        {
+            return Key4(a.cID, a.tID, a.start, a.end) < Key4(b.cID, b.tID, b.start, b.end);
+        });
+
+        std::set<NameID> cIDs;
+
+        for (auto *recs : { &genes, &trans, &exons })
+        {
+            for (const auto &i : *recs)
+            {
+                cIDs.insert(i.cID);
+            }
+        }
+
+        /*
+         * Write the sections into a buffer
+         */
+
+        auto h = key;
+
+        memcpy(h.magic, MAGIC, sizeof(MAGIC));
+
+        h.version = VERSION;
+        h.nChrs   = cIDs.size();
+        h.nNames  = names.size();
+        h.nChars  = 0;
+        h.nGenes  = genes.size();
+        h.nTrans  = trans.size();
+        h.nExons  = uexons.size();
+        h.nIntrs  = intrs.size();
+
+        for (const auto &i : names)
+        {
+            h.nChars += i.size();
+        }
+
+        const auto l = layout(h);
+
+        char *p = new char[l.size];
+        std::shared_ptr<const char> buf(p, std::default_delete<char[]>());
+
+        // Deterministic padding
+        memset(p, 0, l.size);
+        memcpy(p, &h, sizeof(h));
+
+        auto *chrs = reinterpret_cast<Chr *>(p + l.chrs);
+
+        // Range for a chromosome in records sorted by chromosome
+        auto range = [&](const std::vector<Record> &x, NameID cID, std::uint32_t *r)
+        {
+            auto lower = [&](NameID c)
+            {
+                return std::lower_bound(x.begin(), x.end(), c, [&](const Record &a, NameID c)
+                {
+                    return a.cID < c;
+                }) - x.begin();
+            };
+
+            r[0] = lower(cID);
+            r[1] = lower(cID + 1);
+        };
+
+        for (const auto &cID : cIDs)
+        {
+            auto &c = *chrs++;
+
+            c.cID    = cID;
+            c.nGene  = std::distance(gIDs.lower_bound(Key2(cID, 0)), gIDs.lower_bound(Key2(cID + 1, 0)));
+            c.nUExon = nUExon[cID];
+
+            range(genes,  cID, c.genes);
+            range(trans,  cID, c.trans);
+            range(uexons, cID, c.exons);
+            range(intrs,  cID, c.intrs);
+        }
+
+        auto *gs = reinterpret_cast<Gene *>(p + l.genes);
+
+        for (const auto &i : genes)
+        {
+            gs->gID   = i.gID;
+            gs->start = i.start;
+            gs->end   = i.end;
+            gs++;
+        }
+
+        auto *ts = reinterpret_cast<Trans *>(p + l.trans);
+
+        for (const auto &i : trans)
+        {
+            ts->tID   = i.tID;
+            ts->gID   = i.gID;
+            ts->start = i.start;
+            ts->end   = i.end;
+            ts++;
+        }
+
+        auto features = [&](const std::vector<Record> &x, std::size_t off)
+        {
+            auto *f = reinterpret_cast<Feature *>(p + off);
+
+            for (const auto &i : x)
+            {
+                f->tID   = i.tID;
+                f->gID   = t2g(i);
+                f->str   = i.str;
+                f->start = i.start;
+                f->end   = i.end;
+                f++;
+            }
+        };
+
+        features(uexons, l.exons);
+        features(intrs,  l.intrs);
+
+        auto *offs  = reinterpret_cast<std::uint64_t *>(p + l.offs);
+        auto *chars = p + l.chars;
+
+        offs[0] = 0;
+
+        for (auto i = 0; i < names.size(); i++)
+        {
+            memcpy(chars + offs[i], names[i].data(), names[i].size());
+            offs[i+1] = offs[i] + names[i].size();
+        }
+
+        return buf;
+    }
+
+    std::unordered_map<std::string, NameID> ids;
+    std::vector<std::string> names;
+
+    std::vector<Record> genes, trans, exons;
+};
+
+GTFData GTFData::read(const Reader &r, const Path &cache)
+{
+    const auto file = r.src();
+
+    struct stat s;
+
+    Header key;
+    memset(&key, 0, sizeof(key));
+
+    // Snapshot only for a physical file, and only if asked for
+    const auto isFile = !cache.empty() && !file.empty() && !stat(file.c_str(), &s) && S_ISREG(s.st_mode) &&
+                        hashContent(file, s.st_size, key.content);
+
+    if (isFile)
+    {
+        key.size  = s.st_size;
+        key.mtime = s.st_mtime;
+        key.hash  = hashPath(file);
+
+#ifdef __APPLE__
+        key.mtimeNS = s.st_mtimespec.tv_nsec;
+#else
+        key.mtimeNS = s.st_mtim.tv_nsec;
+#endif
+
+        const auto snap = snapshot(file, cache);
+        const auto fd = open(snap.c_str(), O_RDONLY);
+
+        if (fd >= 0)
+        {
+            struct stat ss;
+
+            void *p = !fstat(fd, &ss) && ss.st_size >= sizeof(Header) ?
+                            mmap(nullptr, ss.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+            close(fd);
+
+            if (p != MAP_FAILED)
+            {
+                const auto n = static_cast<std::size_t>(ss.st_size);
+                const auto &h = *static_cast<const Header *>(p);
+
+                std::shared_ptr<const char> buf(static_cast<const char *>(p), [=](const char *p)
+                {
+                    munmap(const_cast<char *>(p), n);
+                });
+
+                // Written for the same file (and not truncated)?
+                if (!memcmp(h.magic, MAGIC, sizeof(MAGIC)) && h.version == VERSION &&
+                    h.size == key.size && h.mtime == key.mtime && h.mtimeNS == key.mtimeNS &&
+                    h.hash == key.hash && h.content == key.content && layout(h).size == n)
+                {
+                    return GTFData(buf, true);
+                }
+            }
+        }
+    }
+
+    Builder b;
+    b.parse(r);
+
+    GTFData x(b.build(key), false);
+
+    if (isFile)
+    {
+        // Written atomically, a concurrent run (or thread) either sees a complete snapshot or nothing
+        const auto snap = snapshot(file, cache);
+
+        // Unique for every writer, even in the same process
+        std::vector<char> tmp(snap.begin(), snap.end());
+        const std::string suffix = ".XXXXXX";
+        tmp.insert(tmp.end(), suffix.begin(), suffix.end());
+        tmp.push_back('\0');
+
+        const auto fd = mkstemp(tmp.data());
+
+        if (fd >= 0)
+        {
+            // Readable by other users of the cache (mkstemp is owner-only)
+            fchmod(fd, 0644);
+
+            if (auto *f = fdopen(fd, "wb"))
+            {
+                const auto n = layout(*x._h).size;
+                const auto w = fwrite(x._buf.get(), 1, n, f) == n;
+
+                if (!fclose(f) && w && !rename(tmp.data(), snap.c_str()))
+                {
+                    return x;
+                }
+            }
+            else
+            {
+                close(fd);
+            }
+
+            std::remove(tmp.data());
+        }
+    }
+
+    return x;
+}
@@ -1,6 +1,9 @@
 #ifndef GTF_DATA_HPP
 #define GTF_DATA_HPP
 
+#include <memory>
+#include <cstdint>
+#include <boost/utility/string_ref.hpp>
 #include "data/hist.hpp"
 #include "tools/tools.hpp"
 #include "data/dinters.hpp"
@@ -10,609 +13,516 @@
 // Defined in main.cpp
 extern void printWarning(const std::string &);
 
+// Defined in main.cpp
+extern Anaquin::Path __cache__;
+
 namespace Anaquin
 {
-    struct ExonData
-    {
-        operator const Locus &() const { return l; }
-        
-        inline bool operator<(const  ExonData &x) const { return l < x.l;  }
-        inline bool operator==(const ExonData &x) const { return l == x.l; }
-        inline bool operator!=(const Locus &l)    const { return !operator==(l); }
-        inline bool operator==(const Locus &l)    const
-        {
-            return this->l.start == l.start && this->l.end == l.end;
-        }
-        
-        inline void operator+=(const ExonData &x)
-        {
-            l.start = std::min(l.start, x.l.start);
-            l.end   = std::max(l.end, x.l.end);
-        }
-
-        inline bool isForward()  const { return str == Strand::Forward;  }
-        inline bool isBackward() const { return str == Strand::Backward; }
-        
-        // Eg: chr1
-        ChrID cID;
-        
-        // Eg: ENSG00000223972.5
-        GeneID gID;
-        
-        // Eg: ENST00000456328.2
-        TransID tID;
-        
-        Strand str;
-        
-        Locus l;
-    };
-    
-    struct TransData
+    /*
+     * Annotation for a GTF file, kept in columns. Names are interned into a sorted string table and
+     * referred by their positions (thus comparing positions is comparing names). Genes, transcripts,
+     * unique exons and unique introns are arrays sorted by chromosome, name and position, each
+     * chromosome has a range in the arrays.
+     *
+     * Everything lives in a single immutable buffer, built by parsing the GTF file or memory-mapped
+     * from a snapshot written by an earlier run into the cache directory. Copies share the buffer.
+     */
+
+    class GTFData
     {
-        // Eg: chr1
-        ChrID cID;
-        
-        // Eg: ENSG00000223972.5
-        GeneID gID;
-        
-        // Eg: ENST00000456328.2
-        TransID tID;
-        
-        Locus l;
-    };
-    
-    struct GeneData
-    {
-        // Eg: chr1
-        ChrID cID;
-        
-        // Eg: ENSG00000223972.5
-        GeneID gID;
-        
-        Locus l;
-    };
+        public:
 
-    typedef ExonData IntronData;
-    
-    struct ChrData
-    {
-        // Transcripts to Data
-        std::map<TransID, TransData> t2d;
-        
-        // Genes to Data
-        std::map<GeneID, GeneData> g2d;
-        
-        // Transcripts to non-unique exons
-        std::map<TransID, std::set<ExonData>> t2e;
-        
-        // Transcripts to unique exons
-        std::map<TransID, std::set<ExonData>> t2ue;
-
-        // Transcripts to unique introns
-        std::map<TransID, std::set<IntronData>> t2ui;
-        
-        // Transcripts to genes
-        std::map<TransID, GeneID> t2g;
-        
-        // Unique exons (forwards + backwards)
-        Counts uexons = 0;
-
-        // Unique introns (forwards + backwards)
-        Counts uintrs = 0;
-        
-        std::set<GeneID> gIDs;
-    };
-    
-    struct GTFData : public std::map<ChrID, ChrData>
-    {
-        // Genes for a chromosome
-        inline std::set<GeneID> genes(const ChrID &x) const
-        {
-            std::set<GeneID> r;
-            
-            for (const auto &i : at(x).g2d)
-            {
-                r.insert(i.first);
-            }
-            
-            return r;
-        }
-        
-        // Genes for all chromosome
-        inline std::map<ChrID, std::set<GeneID>> genes() const
-        {
-            std::map<ChrID, std::set<GeneID>> r;
-            
-            for (const auto &i : *this)
-            {
-                r[i.first] = genes(i.first);
-            }
-            
-            return r;
-        }
-        
-        inline Counts nGene() const
-        {
-            return countMap(*this, [&](const ChrID &cID, const ChrData &x)
-            {
-                return nGene(cID);
-            });
-        }
-        
-        inline Counts countTrans() const
-        {
-            return countMap(*this, [&](const ChrID &cID, const ChrData &x)
-            {
-                return countTrans(cID);
-            });
-        }
-        
-        inline Counts countUExon() const
-        {
-            return countMap(*this, [&](const ChrID &cID, const ChrData &x)
-            {
-                return countUExon(cID);
-            });
-        }
-
-        inline Counts countUIntr() const
-        {
-            return countMap(*this, [&](const ChrID &cID, const ChrData &x)
-            {
-                return countUIntr(cID);
-            });
-        }
-        
-        inline Counts nGene(const ChrID &cID) const
-        {
-            return at(cID).gIDs.size();
-        }
-        
-        inline Counts countTrans(const ChrID &cID) const
-        {
-            return at(cID).t2d.size();
-        }
-        
-        inline Counts countUExon(const ChrID &cID) const
-        {
-            return at(cID).uexons;
-        }
-        
-        inline Counts countUIntr(const ChrID &cID) const
-        {
-            return at(cID).uintrs;
-        }
-
-        inline Counts nGeneSyn() const
-        {
-            return countMap(*this, [&](const ChrID &cID, const ChrData &x)
-            {
-                return isChrIS(cID) ? nGene(cID) : 0;
-            });
-        }
-        
-        inline Counts countTransSyn() const
-        {
-            return countMap(*this, [&](const ChrID &cID, const ChrData &x)
-            {
-                return isChrIS(cID) ? countTrans(cID) : 0;
-            });
-        }
-        
-        inline Counts countUExonSyn() const
-        {
-            return countMap(*this, [&](const ChrID &cID, const ChrData &x)
-            {
-                return isChrIS(cID) ? countUExon(cID) : 0;
-            });
-        }
-        
-        inline Counts countUIntrSyn() const
-        {
-            return countMap(*this, [&](const ChrID &cID, const ChrData &x)
-            {
-                return isChrIS(cID) ? countUIntr(cID) : 0;
-            });
-        }
-
-        inline Counts nGeneGen() const
-        {
-            return nGene() - nGeneSyn();
-        }
-        
-        inline Counts countTransGen() const
-        {
-            return countTrans() - countTransSyn();
-        }
-        
-        inline Counts countUExonGen() const
-        {
-            return countUExon() - countUExonSyn();
-        }
-
-        inline Counts countUIntrGen() const
-        {
-            return countUIntr() - countUIntrSyn();
-        }
-        
-        inline DIntervals<> gIntervals(const ChrID &cID) const
-        {
-            DIntervals<> r;
-            
-            for (const auto &i : at(cID).g2d)
-            {
-                r.add(DInter(i.first, i.second.l));
-            }
-            
-            r.build();
-            return r;
-        }
-        
-        inline std::map<ChrID, DIntervals<>> gIntervals() const
-        {
-            std::map<ChrID, DIntervals<>> r;
-            
-            for (const auto &i : *this)
-            {
-                r[i.first] = gIntervals(i.first);
-            }
-
-            return r;
-        }
-        
-        // Intervals for merged exons
-        inline Chr2MInters meInters(Strand str) const
-        {
-            Chr2MInters r;
-            
-            for (const auto &i : *this)
-            {
-                r[i.first] = meInters(i.first, str);
-            }
-            
-            return r;
-        }
-        
-        // Intervals for merged exons (only possible at the gene level)
-        inline MergedIntervals<> meInters(const ChrID &cID, Strand str) const
-        {
-            MergedIntervals<> r;
-
-            // This is needed to merge exons over all transcripts
-            std::map<GeneID, MergedInterval> merged;
-            
-            // For each transcript...
-            for (const auto &i : at(cID).t2ue)
-            {
-                const auto &tID = i.first;
-                const auto &gID = at(cID).t2g.at(tID);
-
-                if (!merged.count(gID))
+            // Position in the string table
+            typedef std::uint32_t NameID;
+
+            struct Gene
+            {
+                NameID gID;
+                std::uint32_t _;
+                Base start, end;
+            };
+
+            struct Trans
+            {
+                NameID tID, gID;
+                Base start, end;
+            };
+
+            // Unique exon or unique intron
+            struct Feature
+            {
+                NameID tID, gID;
+                Base start, end;
+                std::uint32_t str;
+                std::uint32_t _;
+            };
+
+            struct Chr
+            {
+                NameID cID;
+
+                // Number of genes (transcript records)
+                std::uint32_t nGene;
+
+                // Number of unique exons
+                std::uint32_t nUExon;
+
+                // Ranges [begin, end) in the arrays
+                std::uint32_t genes[2], trans[2], exons[2], intrs[2];
+
+                std::uint32_t _;
+            };
+
+            GTFData() = default;
+
+            /*
+             * Read annotation for a GTF file. Without a cache directory the file is always parsed.
+             * Otherwise the snapshot in the directory (see snapshot()) is used if it was written for the
+             * same file (path, size, modification time in nanoseconds and a hash of the first and last
+             * blocks), else the file is parsed and a new snapshot is written. Failing to write the
+             * snapshot is not an error.
+             */
+
+            static GTFData read(const Reader &, const Path &cache = "");
+
+            // Eg: "<cache>/A.gtf.<hash of the full path>.anaquin.idx" for "A.gtf"
+            static FileName snapshot(const FileName &file, const Path &cache);
+
+            // Whether the data was memory-mapped from a snapshot
+            inline bool mapped() const { return _mapped; }
+
+            inline boost::string_ref name(NameID i) const
+            {
+                return boost::string_ref(_chars + _offs[i], _offs[i+1] - _offs[i]);
+            }
+
+            inline std::string str(NameID i) const { return name(i).to_string(); }
+
+            // Chromosomes sorted by name
+            inline const Chr *begin() const { return _chrs; }
+            inline const Chr *end()   const { return _chrs + nChrs(); }
+
+            inline const Chr &chr(const ChrID &cID) const
+            {
+                const auto i = std::lower_bound(begin(), end(), boost::string_ref(cID), [&](const Chr &x, boost::string_ref y)
                 {
-                    // Merging unique exons (doesn't matter how long this is)
-                    merged[gID] = MergedInterval(gID, Locus(1, std::numeric_limits<Base>::max()));
-                }
-                
-                // For each exon in the transcript...
-                for (const auto &j : i.second)
+                    return name(x.cID) < y;
+                });
+
+                if (i == end() || name(i->cID) != cID)
                 {
-                    if (str != Strand::Either && (j.str != str))
-                    {
-                        break;
-                    }
+                    throw std::runtime_error("Unknown chromosome in GTF: " + cID);
+                }
 
-                    // Merge all the overlapping exons
-                    merged.at(gID).map(j.l);
+                return *i;
+            }
+
+            // Genes for a chromosome
+            inline std::set<GeneID> genes(const ChrID &x) const
+            {
+                std::set<GeneID> r;
+                const auto &c = chr(x);
+
+                for (auto i = c.genes[0]; i < c.genes[1]; i++)
+                {
+                    r.insert(r.end(), str(_genes[i].gID));
                 }
+
+                return r;
             }
-            
-            // For each gene in the chromosome...
-            for (const auto &i : merged)
+
+            // Genes for all chromosome
+            inline std::map<ChrID, std::set<GeneID>> genes() const
             {
-                const auto &gID = i.first;
+                std::map<ChrID, std::set<GeneID>> r;
 
-                // For each merged exon in the gene...
-                for (const auto &j : i.second._data)
+                for (const auto &i : *this)
                 {
-                    const auto &l = j.second;
-                    r.add(MergedInterval(gID + "-" + toString(l.start) + "-" + toString(l.end), l, gID, gID));
+                    r[str(i.cID)] = genes(str(i.cID));
                 }
+
+                return r;
+            }
+
+            inline Counts nGene() const
+            {
+                return count([&](const Chr &x) { return x.nGene; });
             }
 
-            r.build();
-            return r;
-        }
+            inline Counts countTrans() const
+            {
+                return count([&](const Chr &x) { return x.trans[1] - x.trans[0]; });
+            }
 
-        // Intervals for unique exons
-        inline MergedIntervals<> ueInters(const ChrID &cID) const
-        {
-            MergedIntervals<> r;
-            
-            for (const auto &i : at(cID).t2ue)
+            inline Counts countUExon() const
             {
-                const auto &tID = i.first;
-                const auto &gID = at(cID).t2g.at(tID);
-                
-                for (const auto &j : i.second)
+                return count([&](const Chr &x) { return x.nUExon; });
+            }
+
+            inline Counts countUIntr() const
+            {
+                return count([&](const Chr &x) { return x.intrs[1] - x.intrs[0]; });
+            }
+
+            inline Counts nGene(const ChrID &cID) const
+            {
+                return chr(cID).nGene;
+            }
+
+            inline Counts countTrans(const ChrID &cID) const
+            {
+                const auto &c = chr(cID);
+                return c.trans[1] - c.trans[0];
+            }
+
+            inline Counts countUExon(const ChrID &cID) const
+            {
+                return chr(cID).nUExon;
+            }
+
+            inline Counts countUIntr(const ChrID &cID) const
+            {
+                const auto &c = chr(cID);
+                return c.intrs[1] - c.intrs[0];
+            }
+
+            inline Counts nGeneSyn() const
+            {
+                return count([&](const Chr &x) { return isSyn(x) ? x.nGene : 0; });
+            }
+
+            inline Counts countTransSyn() const
+            {
+                return count([&](const Chr &x) { return isSyn(x) ? x.trans[1] - x.trans[0] : 0; });
+            }
+
+            inline Counts countUExonSyn() const
+            {
+                return count([&](const Chr &x) { return isSyn(x) ? x.nUExon : 0; });
+            }
+
+            inline Counts countUIntrSyn() const
+            {
+                return count([&](const Chr &x) { return isSyn(x) ? x.intrs[1] - x.intrs[0] : 0; });
+            }
+
+            inline Counts nGeneGen() const
+            {
+                return nGene() - nGeneSyn();
+            }
+
+            inline Counts countTransGen() const
+            {
+                return countTrans() - countTransSyn();
+            }
+
+            inline Counts countUExonGen() const
+            {
+                return countUExon() - countUExonSyn();
+            }
+
+            inline Counts countUIntrGen() const
+            {
+                return countUIntr() - countUIntrSyn();
+            }
+
+            inline DIntervals<> gIntervals(const ChrID &cID) const
+            {
+                DIntervals<> r;
+                const auto &c = chr(cID);
+
+                for (auto i = c.genes[0]; i < c.genes[1]; i++)
                 {
-                    r.add(MergedInterval(i.first + "-" + toString(j.l.start) + "-" + toString(j.l.end),
-                                         j.l, gID, tID));
+                    const auto &g = _genes[i];
+                    r.add(DInter(str(g.gID), Locus(g.start, g.end)));
                 }
-            }
 
-            r.build();
-            return r;
-        }
+                r.build();
+                return r;
+            }
 
-        // Intervals for unique exons
-        inline Chr2MInters ueInters() const
-        {
-            Chr2MInters r;
-            
-            for (const auto &i : *this)
+            inline std::map<ChrID, DIntervals<>> gIntervals() const
             {
-                r[i.first] = ueInters(i.first);
+                std::map<ChrID, DIntervals<>> r;
+
+                for (const auto &i : *this)
+                {
+                    r[str(i.cID)] = gIntervals(str(i.cID));
+                }
+
+                return r;
             }
-            
-            return r;
-        }
 
-        /*
-         * Returns non-overlapping intervals for a chromosome. Each interval represents a set of merged
-         * overlapping unique exons.
-         */
-        
-        inline MergedIntervals<> mergedExons(const ChrID &cID) const
-        {
-            MergedIntervals<> r;
-            
-            for (const auto &i : at(cID).t2ue)
+            // Intervals for merged exons
+            inline Chr2MInters meInters(Strand str) const
             {
-                const auto &tID = i.first;
-                const auto &gID = at(cID).t2g.at(tID);
+                Chr2MInters r;
 
-                for (auto &j : i.second)
+                for (const auto &i : *this)
                 {
-                    r.merge(MergedInterval(i.first + "-" + toString(j.l.start) + "-" + toString(j.l.end),
-                                           j.l,
-                                           gID,
-                                           tID));
+                    r[this->str(i.cID)] = meInters(this->str(i.cID), str);
                 }
+
+                return r;
             }
 
-            r.build();
-            return r;
-        }
-        
-        /*
-         * Returns non-overlapping exon intervals for all chromosomes.
-         */
-
-        inline Chr2MInters mergedExons() const
-        {
-            Chr2MInters r;
-            
-            for (const auto &i : *this)
-            {
-                r[i.first] = mergedExons(i.first);
-            }
-            
-            return r;
-        }
-        
-        // Intervals for unique introns
-        inline MergedIntervals<> uiInters(const ChrID &cID) const
-        {
-            MergedIntervals<> r;
-            
-            for (const auto &i : at(cID).t2ui)
-            {
-                const auto &tID = i.first;
-                const auto &gID = at(cID).t2g.at(tID);
-
-                for (const auto &j : i.second)
+            // Intervals for merged exons (only possible at the gene level)
+            inline MergedIntervals<> meInters(const ChrID &cID, Strand str) const
+            {
+                MergedIntervals<> r;
+                const auto &c = chr(cID);
+
+                // Exons over all transcripts of each gene
+                std::map<NameID, std::vector<Locus>> g2l;
+
+                // For each transcript (exons sorted by transcript and position)...
+                for (auto i = c.exons[0]; i < c.exons[1];)
+                {
+                    const auto tID = _exons[i].tID;
+                    auto &loci = g2l[_exons[i].gID];
+
+                    auto j = i;
+
+                    for (; j < c.exons[1] && _exons[j].tID == tID; j++)
+                    {
+                        if (str != Strand::Either && (_exons[j].str != str))
+                        {
+                            break;
+                        }
+
+                        loci.push_back(Locus(_exons[j].start, _exons[j].end));
+                    }
+
+                    // Skip the rest of the transcript
+                    for (; j < c.exons[1] && _exons[j].tID == tID; j++) {}
+
+                    i = j;
+                }
+
+                // For each gene in the chromosome...
+                for (const auto &i : g2l)
                 {
-                    r.add(MergedInterval(i.first + "-" + toString(j.l.start) + "-" + toString(j.l.end),
-                                         j.l, gID, tID));
+                    const auto gID = this->str(i.first);
+
+                    // Sorted and merged in a single sweep
+                    for (const auto &l : Locus::merge<Locus, Locus>(i.second))
+                    {
+                        r.add(MergedInterval(gID + "-" + toString(l.start) + "-" + toString(l.end),
+                                             Locus(l.start, l.end), gID, gID));
+                    }
                 }
+
+                r.build();
+                return r;
             }
 
-            // Eg: chrM doesn't have any intron...
-            if (r.size())
+            // Intervals for unique exons
+            inline MergedIntervals<> ueInters(const ChrID &cID) const
             {
+                const auto &c = chr(cID);
+                auto r = inters(_exons, c.exons[0], c.exons[1]);
+
                 r.build();
+                return r;
             }
-            
-            return r;
-        }
-        
-        // Intervals for unique introns
-        inline Chr2MInters uiInters() const
-        {
-            Chr2MInters r;
-            
-            for (const auto &i : *this)
-            {
-                r[i.first] = uiInters(i.first);
-            }
-            
-            return r;
-        }
-        
-        // Returns total length of all genes for a chromosome
-        inline Base countLen(const ChrID &cID) const
-        {
-            // Assuming the genes are non-overlapping
-            return gIntervals(cID).stats().length;
-        }
-        
-        inline Base countLenSyn() const
-        {
-            return countMap(*this, [&](const ChrID &cID, const ChrData &x)
-            {
-                return isChrIS(cID) ? countLen(cID) : 0;
-            });
-        }
-        
-        inline Base countLenGen() const
-        {
-            return countMap(*this, [&](const ChrID &cID, const ChrData &x)
-            {
-                return !isChrIS(cID) ? countLen(cID) : 0;
-            });
-        }
-    };
 
-    inline GTFData gtfData(const Reader &r)
-    {
-        GTFData c2d;
-        
-        // Used for unique exons
-        std::map<std::string, Locus> m_exons;
-        
-        // Used for unique introns
-        std::map<std::string, Locus> m_intrs;
-
-        ExonData ed;
-        GeneData gd;
-        TransData td;
-        IntronData id;
-        
-        ParserGTF::parse(r, [&](const ParserGTF::Data &x, const std::string &, const ParserProgress &)
-        {
-            switch (x.type)
-            {
-                case RNAFeature::Transcript:
+            // Intervals for unique exons
+            inline Chr2MInters ueInters() const
+            {
+                Chr2MInters r;
+
+                for (const auto &i : *this)
                 {
-                    td.l   = x.l;
-                    td.cID = x.cID;
-                    td.gID = x.gID;
-                    td.tID = x.tID;
-
-                    c2d[x.cID].gIDs.insert(td.gID);
-                    c2d[x.cID].t2g[td.tID] = td.gID;
-                    c2d[x.cID].t2d[td.tID] = td;
-                    break;
+                    r[str(i.cID)] = ueInters(str(i.cID));
                 }
 
-                case RNAFeature::Gene:
+                return r;
+            }
+
+            /*
+             * Returns non-overlapping intervals for a chromosome. Each interval represents a set of merged
+             * overlapping unique exons.
+             */
+
+            inline MergedIntervals<> mergedExons(const ChrID &cID) const
+            {
+                const auto &c = chr(cID);
+                std::vector<const Feature *> x;
+
+                for (auto i = c.exons[0]; i < c.exons[1]; i++)
                 {
-                    gd.l   = x.l;
-                    gd.cID = x.cID;
-                    gd.gID = x.gID;
-                    
-                    c2d[x.cID].g2d[gd.gID] = gd;
-                    break;
+                    x.push_back(&_exons[i]);
                 }
 
-                case RNAFeature::Exon:
+                std::sort(x.begin(), x.end(), [&](const Feature *a, const Feature *b)
                 {
-                    ed.l   = x.l;
-                    ed.str = x.str;
-                    ed.cID = x.cID;
-                    ed.gID = x.gID;
-                    ed.tID = x.tID;
-
-                    c2d[x.cID].t2e[ed.tID].insert(ed);
-
-                    // The key represents a unique exon
-                    const auto key = (boost::format("%1%_%2%_%3%-%4%") % x.cID
-                                                                       % x.str
-                                                                       % x.l.start
-                                                                       % x.l.end).str();
-
-                    // Make sure it's unique due to alternative splicing
-                    if (!m_exons.count(key))
+                    return a->start < b->start || (a->start == b->start && a->end < b->end);
+                });
+
+                MergedIntervals<> r;
+
+                // Sweep for the overlapping exons, a merged interval is named by its first exon
+                for (auto i = 0; i < x.size();)
+                {
+                    const auto &f = *x[i];
+                    auto end = f.end;
+
+                    auto j = i + 1;
+
+                    for (; j < x.size() && x[j]->start <= end; j++)
                     {
-                        m_exons[key] = x.l;
-                        c2d[x.cID].uexons++;
-                        c2d[x.cID].t2ue[ed.tID].insert(ed);
+                        end = std::max(end, x[j]->end);
                     }
-                    
-                    break;
+
+                    const auto tID = str(f.tID);
+
+                    r.add(MergedInterval(tID + "-" + toString(f.start) + "-" + toString(f.end),
+                                         Locus(f.start, end),
+                                         str(f.gID),
+                                         tID));
+                    i = j;
                 }
 
-                // Eg: CDS
-                default: { break; }
-            }
-        });
-        
-        /*
-         * The information we have is sufficient for exons, transcripts and genes. We just
-         * need to compute introns.
-         */
-        
-        // For each chromosome...
-        for (auto &i : c2d)
-        {
-            // For each transcript...
-            for (const auto &j : i.second.t2e)
-            {
-                // Sorted exons
-                auto sorted = std::vector<ExonData>();
-                
-                // Sort the exons
-                std::copy(j.second.begin(), j.second.end(), std::back_inserter(sorted));
-                
-                /*
-                 * -------------------------------------- Cufflinks Bug --------------------------------------
-                 *
-                 * It's possible for Cufflink guided assembly to give a transcript in both forward and backward
-                 * strand. An example is in "cufflink_bug.png" in the source distribution. Clearly invalid,
-                 * and thus we'll ignore the transcript.
-                 */
-                
-                bool shouldSkip = false;
-
-                for (auto k = 1; k < sorted.size() && !shouldSkip; k++)
+                r.build();
+                return r;
+            }
+
+            /*
+             * Returns non-overlapping exon intervals for all chromosomes.
+             */
+
+            inline Chr2MInters mergedExons() const
+            {
+                Chr2MInters r;
+
+                for (const auto &i : *this)
                 {
-                    const auto &x = sorted[k-1];
-                    const auto &y = sorted[k];
+                    r[str(i.cID)] = mergedExons(str(i.cID));
+                }
 
-                    if (x.str != y.str)
-                    {
-                        printWarning(j.first + " gives transcription in both forward and backward strand. Ignored.");
-                        shouldSkip = true;
-                    }
+                return r;
+            }
+
+            // Intervals for unique introns
+            inline MergedIntervals<> uiInters(const ChrID &cID) const
+            {
+                const auto &c = chr(cID);
+                auto r = inters(_intrs, c.intrs[0], c.intrs[1]);
+
+                // Eg: chrM doesn't have any intron...
+                if (r.size())
+                {
+                    r.build();
                 }
 
-                /*
-                 * Generating introns, only possible once the exons are sorted.
-                 */
-                
-                for (auto j = 1; j < sorted.size() && !shouldSkip; j++)
+                return r;
+            }
+
+            // Intervals for unique introns
+            inline Chr2MInters uiInters() const
+            {
+                Chr2MInters r;
+
+                for (const auto &i : *this)
                 {
-                    const auto &x = sorted[j-1];
-                    const auto &y = sorted[j];
-
-                    id.cID = x.cID;
-                    id.gID = x.gID;
-                    id.tID = x.tID;
-                    id.str = x.str;
-
-                    // Intron spans between exons
-                    id.l = Locus(x.l.end+1, y.l.start-1);
-
-                    #define MIN_INTRON_LEN 4
-                    
-                    const auto key = (boost::format("%1%_%2%-%3%") % x.cID
-                                                                   % id.l.start
-                                                                   % id.l.end).str();
-                    
-                    if (isChrIS(i.first) || id.l.length() >= MIN_INTRON_LEN)
-                    {
-                        if (!m_intrs.count(key))
-                        {
-                            c2d[x.cID].uintrs++;
-                            m_intrs[key] = id.l;
-                            c2d[x.cID].t2ui[id.tID].insert(id);
-                        }
-                    }
+                    r[str(i.cID)] = uiInters(str(i.cID));
                 }
+
+                return r;
+            }
+
+            // Returns total length of all genes for a chromosome
+            inline Base countLen(const ChrID &cID) const
+            {
+                // Assuming the genes are non-overlapping
+                return gIntervals(cID).stats().length;
             }
-        }
 
-        return c2d;
+            inline Base countLenSyn() const
+            {
+                return count([&](const Chr &x) { return isSyn(x) ? countLen(str(x.cID)) : 0; });
+            }
+
+            inline Base countLenGen() const
+            {
+                return count([&](const Chr &x) { return !isSyn(x) ? countLen(str(x.cID)) : 0; });
+            }
+
+        private:
+
+            // Snapshot header, the sections follow in the order of the counts
+            struct Header
+            {
+                char magic[8];
+                std::uint32_t version;
+                std::uint32_t nChrs;
+                std::uint64_t nNames, nChars, nGenes, nTrans, nExons, nIntrs;
+
+                // The GTF file for the snapshot
+                std::uint64_t size, hash;
+                std::int64_t mtime, mtimeNS;
+
+                // Hash of the first and last blocks in the file
+                std::uint64_t content;
+            };
+
+            // Builds the buffer from parsing
+            struct Builder;
+
+            // Take the buffer, pointers are set up for the sections
+            GTFData(std::shared_ptr<const char>, bool mapped);
+
+            inline std::size_t nChrs() const { return _h ? _h->nChrs : 0; }
+
+            inline bool isSyn(const Chr &x) const { return isChrIS(str(x.cID)); }
+
+            template <typename F> Counts count(F f) const
+            {
+                Counts n = 0;
+
+                for (const auto &i : *this)
+                {
+                    n += f(i);
+                }
+
+                return n;
+            }
+
+            inline MergedIntervals<> inters(const Feature *x, std::uint32_t i, std::uint32_t j) const
+            {
+                MergedIntervals<> r;
+
+                for (; i < j; i++)
+                {
+                    const auto tID = str(x[i].tID);
+
+                    r.add(MergedInterval(tID + "-" + toString(x[i].start) + "-" + toString(x[i].end),
+                                         Locus(x[i].start, x[i].end), str(x[i].gID), tID));
+                }
+
+                return r;
+            }
+
+            std::shared_ptr<const char> _buf;
+
+            bool _mapped = false;
+
+            const Header  *_h     = nullptr;
+            const Chr     *_chrs  = nullptr;
+            const Gene    *_genes = nullptr;
+            const Trans   *_trans = nullptr;
+            const Feature *_exons = nullptr;
+            const Feature *_intrs = nullptr;
+
+            // Offsets of the names in the characters
+            const std::uint64_t *_offs = nullptr;
+
+            const char *_chars = nullptr;
+    };
+
+    inline GTFData gtfData(const Reader &r)
+    {
+        return GTFData::read(r, __cache__);
     }
 }
 
@@ -0,0 +1,80 @@
+#ifndef QUEUE_HPP
+#define QUEUE_HPP
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace Anaquin
+{
+    /*
+     * Thread-safe FIFO with a fixed capacity. Producers block while the queue is full and consumers
+     * block while it's empty. Once closed, pushing fails and popping fails as soon as the queue
+     * has been drained.
+     */
+
+    template <typename T> class BoundedQueue
+    {
+        public:
+
+            BoundedQueue(std::size_t n) : _n(n) {}
+
+            inline bool push(const T &x)
+            {
+                std::unique_lock<std::mutex> lock(_m);
+
+                _full.wait(lock, [&]() { return _closed || _data.size() < _n; });
+
+                if (_closed)
+                {
+                    return false;
+                }
+
+                _data.push_back(x);
+                _empty.notify_one();
+
+                return true;
+            }
+
+            inline bool pop(T &x)
+            {
+                std::unique_lock<std::mutex> lock(_m);
+
+                _empty.wait(lock, [&]() { return _closed || !_data.empty(); });
+
+                if (_data.empty())
+                {
+                    return false;
+                }
+
+                x = _data.front();
+                _data.pop_front();
+                _full.notify_one();
+
+                return true;
+            }
+
+            inline void close()
+            {
+                std::lock_guard<std::mutex> lock(_m);
+
+                _closed = true;
+                _full.notify_all();
+                _empty.notify_all();
+            }
+
+        private:
+
+            // Maximum number of elements
+            const std::size_t _n;
+
+            bool _closed = false;
+
+            std::deque<T> _data;
+
+            std::mutex _m;
+            std::condition_variable _full, _empty;
+    };
+}
+
+#endif
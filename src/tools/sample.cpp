@@ -4,15 +4,20 @@
 
 using namespace Anaquin;
 
-Sampler::Stats Sampler::sample(const FileName &file, Proportion p, const AnalyzerOptions &o, std::function<bool (const ChrID &)> isSyn)
+Sampler::Stats Sampler::sample(const FileName &file, const FileName &dst, Proportion p, const AnalyzerOptions &o, std::function<bool (const ChrID &)> isSyn)
 {
     Sampler::Stats stats;
 
     A_ASSERT(p > 0.0 && p <= 1.0);
     Random r(1.0 - p);
 
+    if (!dst.empty())
+    {
+        o.generate(dst);
+    }
+    
     SAMWriter w;
-    w.open("");
+    w.open(dst, file);
     
     ParserBAM::parse(file, [&](ParserBAM::Data &x, const ParserBAM::Info &info)
     {
@@ -55,7 +60,7 @@ Sampler::Stats Sampler::sample(const FileName &file, Proportion p, const Analyze
                 w.write(x);
             }
         }
-    }, true);
+    });
     
     A_ASSERT(stats.before.syn >= stats.after.syn);
     stats.after.gen = stats.before.gen;
@@ -26,7 +26,9 @@ namespace Anaquin
             SGReads before, after;
         };
         
+        // Sample to the output file (empty for the console)
         static Stats sample(const FileName &,
+                            const FileName &,
                             Proportion,
                             const AnalyzerOptions &,
                             std::function<bool (const ChrID &)>);
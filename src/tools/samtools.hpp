@@ -62,42 +62,106 @@ namespace Anaquin
         return rID;
     }
     
-    inline std::string bam2qual(bam1_t *x)
+    /*
+     * Bases for every byte of a packed sequence (two bases per byte)
+     */
+    
+    struct NibbleTable
     {
-        std::stringstream buf;
-        
-        for (auto i = 0; i < x->core.l_qseq; ++i)
+        NibbleTable()
         {
-            buf << (char) (bam_get_qual(x)[i] + 33);
+            for (auto i = 0; i < 256; i++)
+            {
+                x[i][0] = seq_nt16_str[i >> 4];
+                x[i][1] = seq_nt16_str[i & 0xf];
+            }
         }
         
-        return buf.str();
-    }
+        char x[256][2];
+    };
     
-    inline std::string bam2seq(bam1_t *x)
+    inline void bam2qual(const bam1_t *x, std::string &r)
     {
-        std::stringstream buf;
-
-        for (auto i = 0; i < x->core.l_qseq; ++i)
+        const auto n = x->core.l_qseq;
+        const auto q = bam_get_qual(x);
+        
+        r.resize(n);
+        
+        for (auto i = 0; i < n; i++)
         {
-            buf << seq_nt16_str[bam_seqi(bam_get_seq(x),i)];
+            r[i] = static_cast<char>(q[i] + 33);
         }
+    }
 
-        return buf.str();
+    inline void bam2seq(const bam1_t *x, std::string &r)
+    {
+        static const NibbleTable t;
+        
+        const auto n = x->core.l_qseq;
+        const auto s = bam_get_seq(x);
+        
+        r.resize(n);
+        
+        auto i = 0;
+        
+        for (; i + 1 < n; i += 2)
+        {
+            const auto &p = t.x[s[i >> 1]];
+            r[i]   = p[0];
+            r[i+1] = p[1];
+        }
+        
+        // Odd number of bases
+        if (i < n)
+        {
+            r[i] = t.x[s[i >> 1]][0];
+        }
     }
     
-    inline CigarStr bam2cigar(bam1_t *x)
+    inline void bam2cigar(const bam1_t *x, CigarStr &r)
     {
-        std::stringstream buf;
+        static const char ops[] = "MIDNSHP=XB";
+        
         const auto t = bam_get_cigar(x);
-
+        
+        r.clear();
+        
         for (auto i = 0; i < x->core.n_cigar; i++)
         {
-            buf << std::to_string(bam_cigar_oplen(t[i]));
-            buf << bam2char.at(bam_cigar_op(t[i]));
+            char buf[16];
+            auto j = sizeof(buf);
+            
+            const auto op = bam_cigar_op(t[i]);
+            buf[--j] = op < sizeof(ops) - 1 ? ops[op] : '?';
+            
+            for (auto n = bam_cigar_oplen(t[i]); j == sizeof(buf) - 1 || n; n /= 10)
+            {
+                buf[--j] = '0' + n % 10;
+            }
+            
+            r.append(buf + j, sizeof(buf) - j);
         }
-        
-        return buf.str();
+    }
+
+    inline std::string bam2qual(bam1_t *x)
+    {
+        std::string r;
+        bam2qual(x, r);
+        return r;
+    }
+    
+    inline std::string bam2seq(bam1_t *x)
+    {
+        std::string r;
+        bam2seq(x, r);
+        return r;
+    }
+    
+    inline CigarStr bam2cigar(bam1_t *x)
+    {
+        CigarStr r;
+        bam2cigar(x, r);
+        return r;
     }
 
     inline std::vector<int> bam2delta(bam1_t *x)
@@ -0,0 +1,58 @@
+#ifndef TASKS_HPP
+#define TASKS_HPP
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <functional>
+
+namespace Anaquin
+{
+    typedef std::function<void ()> Task;
+    
+    /*
+     * Run every task on its own thread and wait for all of them. The first exception thrown by a
+     * task is rethrown once all tasks have finished.
+     */
+
+    inline void runTasks(const std::vector<Task> &x)
+    {
+        std::mutex m;
+        std::exception_ptr err;
+        
+        std::vector<std::thread> threads;
+        
+        for (const auto &i : x)
+        {
+            threads.push_back(std::thread([&]()
+            {
+                try
+                {
+                    i();
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    
+                    if (!err)
+                    {
+                        err = std::current_exception();
+                    }
+                }
+            }));
+        }
+        
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+        
+        if (err)
+        {
+            std::rethrow_exception(err);
+        }
+    }
+}
+
+#endif
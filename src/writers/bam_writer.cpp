@@ -14,17 +14,17 @@ void BAMWriter::open(const FileName &file)
 
 void BAMWriter::write(const ParserBAM::Data &x)
 {
-    const auto *b = reinterpret_cast<bam1_t *>(x.b());
-    const auto *h = reinterpret_cast<bam_hdr_t *>(x.h());
-    
-    static bool header = false;
-    
-    if (!header && sam_hdr_write(_fp, reinterpret_cast<bam_hdr_t *>(x.h())) == -1)
+    write(reinterpret_cast<bam_hdr_t *>(x.h()), reinterpret_cast<bam1_t *>(x.b()));
+}
+
+void BAMWriter::write(const bam_hdr_t *h, const bam1_t *b)
+{
+    if (!_header && sam_hdr_write(_fp, const_cast<bam_hdr_t *>(h)) == -1)
     {
         throw std::runtime_error("sam_hdr_write failed");
     }
     
-    header = true;
+    _header = true;
     
     if (sam_write1(_fp, h, b) == -1)
     {
@@ -13,8 +13,13 @@ namespace Anaquin
             void close();
             void open(const FileName &);
             void write(const ParserBAM::Data &);
+            void write(const bam_hdr_t *, const bam1_t *);
 
         private:
+        
+            // Whether the header has written
+            bool _header = false;
+        
             samFile *_fp;
     };
 }
@@ -0,0 +1,127 @@
+#ifndef FASTQ_WRITER_HPP
+#define FASTQ_WRITER_HPP
+
+#include <cstdio>
+#include <string>
+#include <htslib/bgzf.h>
+#include "data/data.hpp"
+
+// Defined in main.cpp
+extern int __level__;
+
+namespace Anaquin
+{
+    /*
+     * Writing FASTQ records. Records are formatted into a large buffer and written in blocks, the
+     * blocks are compressed (BGZF, readable by gzip) if the file ends with ".gz". Compression can
+     * be shared with other writers through a thread pool.
+     */
+
+    class FASTQWriter
+    {
+        public:
+
+            // Number of bytes buffered before writing
+            static const std::size_t BUFFER_SIZE = 1 << 22;
+
+            inline void open(const FileName &file, htsThreadPool *pool = nullptr)
+            {
+                _file = file;
+                _buf.reserve(BUFFER_SIZE + 4096);
+
+                if (file.size() > 3 && file.compare(file.size() - 3, 3, ".gz") == 0)
+                {
+                    const auto mode = "w" + (__level__ >= 0 ? std::to_string(__level__) : "");
+
+                    if (!(_bgzf = bgzf_open(file.c_str(), mode.c_str())))
+                    {
+                        throw std::runtime_error("Failed to open: " + file);
+                    }
+
+                    if (pool && pool->pool)
+                    {
+                        bgzf_thread_pool(_bgzf, pool->pool, pool->qsize);
+                    }
+                }
+                else if (!(_fp = fopen(file.c_str(), "wb")))
+                {
+                    throw std::runtime_error("Failed to open: " + file);
+                }
+            }
+
+            inline void close()
+            {
+                if (_bgzf || _fp)
+                {
+                    flush();
+                }
+
+                if (_bgzf)
+                {
+                    if (bgzf_close(_bgzf) < 0)
+                    {
+                        throw std::runtime_error("Failed to close: " + _file);
+                    }
+
+                    _bgzf = nullptr;
+                }
+
+                if (_fp)
+                {
+                    fclose(_fp);
+                    _fp = nullptr;
+                }
+            }
+
+            // Eg: "@" + name + "/1", sequence, "+" and quality
+            inline void write(const ReadName &name, const char *suffix, const std::string &seq, const std::string &qual)
+            {
+                _buf += '@';
+                _buf += name;
+                _buf += suffix;
+                _buf += '\n';
+                _buf += seq;
+                _buf += "\n+\n";
+                _buf += qual;
+                _buf += '\n';
+
+                if (_buf.size() >= BUFFER_SIZE)
+                {
+                    flush();
+                }
+            }
+
+        private:
+
+            inline void flush()
+            {
+                if (_buf.empty())
+                {
+                    return;
+                }
+
+                const auto n = _bgzf ? bgzf_write(_bgzf, _buf.data(), _buf.size()) :
+                                       static_cast<ssize_t>(fwrite(_buf.data(), 1, _buf.size(), _fp));
+
+                if (n != static_cast<ssize_t>(_buf.size()))
+                {
+                    throw std::runtime_error("Failed to write: " + _file);
+                }
+
+                _buf.clear();
+            }
+
+            FileName _file;
+
+            // Formatted records not yet written
+            std::string _buf;
+
+            // Only for compressed output
+            BGZF *_bgzf = nullptr;
+
+            // Only for uncompressed output
+            FILE *_fp = nullptr;
+    };
+}
+
+#endif
@@ -62,7 +62,8 @@ namespace Anaquin
 
                 if (newLine)
                 {
-                    *(_o) << std::endl;
+                    // Flushed when the file is closed
+                    *(_o) << '\n';
                 }
             }
 
@@ -1,24 +1,138 @@
 #ifndef SAM_WRITER_HPP
 #define SAM_WRITER_HPP
 
+#include <cstring>
 #include <htslib/sam.h>
 #include "tools/samtools.hpp"
 #include "writers/writer.hpp"
 
+// Defined in main.cpp
+extern int __level__;
+
+// Defined in main.cpp
+extern bool __index__;
+
+// Defined in main.cpp
+extern unsigned __threads__;
+
+// Defined in main.cpp
+extern std::string __format__;
+
 namespace Anaquin
 {
+    /*
+     * Writing alignments. SAM is written to the console as before, BAM and CRAM are compressed
+     * directly into a file (with optional index). Format, compression level and indexing are
+     * specified by the general options.
+     */
+
     class SAMWriter : public Writer
     {
         public:
 
+            // Output file for the alignments, empty if the alignments should be written to the console
+            static FileName file(const FileName &prefix)
+            {
+                if (__format__ == "BAM")
+                {
+                    return prefix + ".bam";
+                }
+                else if (__format__ == "CRAM")
+                {
+                    return prefix + ".cram";
+                }
+
+                return "";
+            }
+
             inline void close() override
             {
-                sam_close(_fp);
+                if (_fp)
+                {
+                    if (_index && sam_idx_save(_fp) < 0)
+                    {
+                        throw std::runtime_error("Failed to save index for " + _file);
+                    }
+
+                    sam_close(_fp);
+                    _fp = nullptr;
+                }
+                else
+                {
+                    std::cout.flush();
+                }
+
+                if (_h)
+                {
+                    bam_hdr_destroy(_h);
+                    _h = nullptr;
+                }
+
+                free(_str.s);
+                _str = { 0, 0, nullptr };
             }
 
             inline void open(const FileName &file) override
             {
-                _fp = sam_open("/dev/null", "w");
+                _file = file;
+
+                // SAM written to the console
+                if (file.empty())
+                {
+                    return;
+                }
+
+                // Eg: "wb6" for BAM with compression level 6
+                auto mode = std::string(__format__ == "CRAM" ? "wc" : "wb");
+
+                if (__level__ >= 0)
+                {
+                    mode += std::to_string(__level__);
+                }
+
+                if (!(_fp = sam_open(file.c_str(), mode.c_str())))
+                {
+                    throw std::runtime_error("Failed to open: " + file);
+                }
+
+                if (__threads__ > 1)
+                {
+                    hts_set_threads(_fp, __threads__);
+                }
+
+                if (__format__ == "CRAM")
+                {
+                    // We don't have the reference genome, sequences are stored as they are
+                    hts_set_opt(_fp, CRAM_OPT_NO_REF, 1);
+                }
+            }
+
+            /*
+             * Open for the alignments in src. The header of src is written immediately, thus the output
+             * is valid even if no alignment is written.
+             */
+
+            inline void open(const FileName &file, const FileName &src)
+            {
+                open(file);
+
+                auto *f = sam_open(src.c_str(), "r");
+
+                if (!f)
+                {
+                    throw std::runtime_error("Failed to open: " + src);
+                }
+
+                _h = sam_hdr_read(f);
+                sam_close(f);
+
+                if (!_h)
+                {
+                    throw std::runtime_error("Failed to read header from " + src);
+                }
+
+                header(_h);
+                _header = true;
             }
 
             inline void write(const std::string &, bool) override
@@ -33,16 +147,29 @@ namespace Anaquin
 
                 if (!_header)
                 {
-                    std::cout << std::string(h->text);
+                    header(const_cast<bam_hdr_t *>(h));
+                    _header = true;
+                }
+
+                if (_fp)
+                {
+                    if (sam_write1(_fp, h, b) == -1)
+                    {
+                        throw std::runtime_error("Failed to write alignment to " + _file);
+                    }
                 }
-                
-                if (sam_write1(_fp, h, b) == -1)
+                else
                 {
-                    throw std::runtime_error("Failed to SAM record");
+                    _str.l = 0;
+
+                    if (sam_format1(h, b, &_str) < 0)
+                    {
+                        throw std::runtime_error("Failed to SAM record");
+                    }
+
+                    std::cout.write(_str.s, _str.l);
+                    std::cout.put('\n');
                 }
-                
-                std::cout << std::string(_fp->line.s);
-                _header = true;
             }
 
             inline void create(const std::string &) override
@@ -52,11 +179,55 @@ namespace Anaquin
 
         private:
 
+            inline void header(bam_hdr_t *h)
+            {
+                if (!_fp)
+                {
+                    std::cout << std::string(h->text);
+                    return;
+                }
+
+                if (sam_hdr_write(_fp, h) == -1)
+                {
+                    throw std::runtime_error("Failed to write header to " + _file);
+                }
+
+                if (__index__)
+                {
+                    // Indexing on the fly requires the output sorted by coordinates
+                    if (!h->text || !strstr(h->text, "SO:coordinate"))
+                    {
+                        throw std::runtime_error(_file + " can't be indexed because the input alignments are not sorted by coordinates. Please sort the alignments and try again.");
+                    }
+
+                    const auto idx = _file + (__format__ == "CRAM" ? ".crai" : ".bai");
+
+                    if (sam_idx_init(_fp, h, 0, idx.c_str()) < 0)
+                    {
+                        throw std::runtime_error("Failed to initialize index for " + _file);
+                    }
+
+                    _index = true;
+                }
+            }
+
+            // Output file (empty for the console)
+            FileName _file;
+
             // Whether the header has written
             bool _header = false;
 
-            // File pointer
-            samFile *_fp;
+            // Whether an index is built
+            bool _index = false;
+
+            // Header written on opening (owned until closing)
+            bam_hdr_t *_h = nullptr;
+
+            // Buffer for formatting SAM records
+            kstring_t _str = { 0, 0, nullptr };
+
+            // File pointer (only for BAM and CRAM)
+            samFile *_fp = nullptr;
     };
 }
 
@@ -0,0 +1,138 @@
+#include <catch.hpp>
+#include "RnaQuin/RnaQuin.hpp"
+#include "RnaQuin/r_compare.hpp"
+
+using namespace Anaquin;
+
+static std::string exon(Base start, Base end, char str, const GeneID &gID, const TransID &tID)
+{
+    return "chrIS\tAnaquin\texon\t" + std::to_string(start) + "\t" + std::to_string(end) + "\t.\t" + str +
+           "\t.\tgene_id \"" + gID + "\"; transcript_id \"" + tID + "\";\n";
+}
+
+static std::map<SequinID, RCompare::Stats> compare()
+{
+    const auto ref = exon(1001, 1100, '+', "S1", "S1_1") +
+                     exon(1201, 1300, '+', "S1", "S1_1") +
+                     exon(1401, 1500, '+', "S1", "S1_1") +
+                     exon(1001, 1100, '+', "S1", "S1_2") +
+                     exon(1401, 1500, '+', "S1", "S1_2") +
+                     exon(3001, 3500, '+', "S2", "S2_1") +
+                     exon(5001, 5100, '-', "S3", "S3_1") +
+                     exon(5201, 5300, '-', "S3", "S3_1");
+
+    const auto qry = exon(1001, 1100, '+', "Q1", "Q1_1") + // Same as S1_1
+                     exon(1201, 1300, '+', "Q1", "Q1_1") +
+                     exon(1401, 1500, '+', "Q1", "Q1_1") +
+                     exon(1001, 1100, '+', "Q2", "Q2_1") + // Second exon shorter than S1_1
+                     exon(1201, 1290, '+', "Q2", "Q2_1") +
+                     exon(1401, 1500, '+', "Q2", "Q2_1") +
+                     exon(3051, 3500, '+', "Q3", "Q3_1") + // Overlapping 90% of S2_1
+                     exon(3301, 3700, '+', "Q4", "Q4_1") + // Overlapping 40% of S2_1
+                     exon(4901, 5100, '+', "Q5", "Q5_1") + // Covering S3_1 on the wrong strand
+                     exon(5201, 5400, '+', "Q5", "Q5_1") +
+                     exon(5001, 5100, '-', "Q6", "Q6_1") + // Same intron as S3_1, last exon shorter
+                     exon(5201, 5250, '-', "Q6", "Q6_1");
+
+    const auto r = RCompare::read(Reader(ref, DataMode::String), isChrIS);
+    const auto q = RCompare::read(Reader(qry, DataMode::String), isChrIS);
+
+    return RCompare::compare(r, q, std::set<SequinID> { "S1", "S2", "S3" });
+}
+
+TEST_CASE("RCompare_Base")
+{
+    const auto r = compare();
+
+    REQUIRE(r.size() == 3);
+
+    // Sensitivity reported by Cuffcompare for each sequin against the query
+    REQUIRE(r.at("S1").base.sn() == Approx(1.00));
+    REQUIRE(r.at("S2").base.sn() == Approx(0.90));
+    REQUIRE(r.at("S3").base.sn() == Approx(0.75));
+
+    REQUIRE(r.at("S1").base.rN == 300);
+    REQUIRE(r.at("S1").base.qN == 300);
+    REQUIRE(r.at("S2").base.rN == 500);
+    REQUIRE(r.at("S2").base.qN == 650);
+    REQUIRE(r.at("S2").base.rTP == 450);
+    REQUIRE(r.at("S3").base.rN == 200);
+    REQUIRE(r.at("S3").base.qN == 150);
+    REQUIRE(r.at("S3").base.rTP == 150);
+}
+
+TEST_CASE("RCompare_Exon")
+{
+    const auto r = compare();
+
+    // Only exact matches, Q2's second exon is partial
+    REQUIRE(r.at("S1").exon.rN  == 3);
+    REQUIRE(r.at("S1").exon.qN  == 4);
+    REQUIRE(r.at("S1").exon.rTP == 3);
+    REQUIRE(r.at("S1").exon.qTP == 3);
+
+    // Terminal exons must match exactly too (Cuffcompare gives 2 of 2 for S3)
+    REQUIRE(r.at("S3").exon.rN  == 2);
+    REQUIRE(r.at("S3").exon.qN  == 2);
+    REQUIRE(r.at("S3").exon.rTP == 1);
+    REQUIRE(r.at("S3").exon.qTP == 1);
+}
+
+TEST_CASE("RCompare_Intron")
+{
+    const auto r = compare();
+
+    REQUIRE(r.at("S1").intr.rN  == 3);
+    REQUIRE(r.at("S1").intr.qN  == 3);
+    REQUIRE(r.at("S1").intr.rTP == 2);
+    REQUIRE(r.at("S1").intr.qTP == 2);
+
+    REQUIRE(r.at("S2").intr.rN == 0);
+    REQUIRE(r.at("S2").intr.qN == 0);
+}
+
+TEST_CASE("RCompare_Chain")
+{
+    const auto r = compare();
+
+    // S1_1 and Q1_1 have the same introns, S1_2 and Q2_1 don't
+    REQUIRE(r.at("S1").chain.rN  == 2);
+    REQUIRE(r.at("S1").chain.rTP == 1);
+    REQUIRE(r.at("S1").chain.qN  == 2);
+    REQUIRE(r.at("S1").chain.qTP == 1);
+    REQUIRE(r.at("S1").trans.rN  == 2);
+    REQUIRE(r.at("S1").trans.rTP == 1);
+    REQUIRE(r.at("S1").trans.qN  == 2);
+    REQUIRE(r.at("S1").trans.qTP == 1);
+
+    // Only the introns must match, not the terminal exons (Cuffcompare gives 0 of 1 transcript for S3)
+    REQUIRE(r.at("S3").chain.rTP == 1);
+    REQUIRE(r.at("S3").chain.qTP == 1);
+    REQUIRE(r.at("S3").trans.rTP == 1);
+    REQUIRE(r.at("S3").trans.qTP == 1);
+}
+
+TEST_CASE("RCompare_SingleExon")
+{
+    const auto r = compare();
+
+    // Single-exon transcripts are not intron chains
+    REQUIRE(r.at("S2").chain.rN == 0);
+    REQUIRE(r.at("S2").chain.qN == 0);
+
+    // Q3_1 overlaps at least 80% of S2_1, Q4_1 doesn't (Cuffcompare gives 0 of 1 transcript for S2)
+    REQUIRE(r.at("S2").trans.rN  == 1);
+    REQUIRE(r.at("S2").trans.rTP == 1);
+    REQUIRE(r.at("S2").trans.qN  == 2);
+    REQUIRE(r.at("S2").trans.qTP == 1);
+}
+
+TEST_CASE("RCompare_Strand")
+{
+    const auto r = compare();
+
+    // Q5_1 is on the other strand, only Q6_1 is compared against S3
+    REQUIRE(r.at("S3").trans.qN == 1);
+    REQUIRE(r.at("S3").exon.qN  == 2);
+    REQUIRE(r.at("S3").base.qN  == 150);
+}
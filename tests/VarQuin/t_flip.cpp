@@ -1,6 +1,9 @@
+#include <cstdlib>
+#include <unistd.h>
 #include <catch.hpp>
 #include "test.hpp"
 #include "VarQuin/v_flip.hpp"
+#include "VarQuin/v_mates.hpp"
 
 using namespace Anaquin;
 
@@ -17,7 +20,7 @@ TEST_CASE("VFlip_1")
             return true;
         }
         
-        void process(const ParserBAM::Data &x, const ParserBAM::Data &y, Status status)
+        void process(const VFlip::Mate &x, const VFlip::Mate &y, Status status)
         {
             switch (status)
             {
@@ -68,9 +71,9 @@ TEST_CASE("VFlip_1")
             }
         }
 
-        std::map<ReadName, ParserBAM::Data> hangs;
-        std::map<ReadName, ParserBAM::Data> rever1;
-        std::map<ReadName, ParserBAM::Data> rever2;
+        std::map<ReadName, VFlip::Mate> hangs;
+        std::map<ReadName, VFlip::Mate> rever1;
+        std::map<ReadName, VFlip::Mate> rever2;
     };
 
     Impl impl;
@@ -96,3 +99,73 @@ TEST_CASE("VFlip_1")
     REQUIRE(impl.rever2["1-hg38.fwd.NA12878_homos.sim_reads12533664"].cID  == "chr1");
     REQUIRE(impl.rever2["1-hg38.fwd.NA12878_homos.sim_reads12533664"].seq  == "TACGTTACCGCACTAGAGCCGAGTGACGTTGGAGACGGAGGACCCAAGTTCGCTAAGAACACGGAGTCGGAGGACTCATCGACCCTGATGTCAACGGGTGGTGATGCGGGTCGATTAAAAACATA");
 }
+
+// Pair 160 mates (40 are hanging) with the memory budget, returns whether any mate was spilled
+static bool testMateStore(std::size_t budget)
+{
+    // Spilled partitions go to a temporary directory
+    char dir[] = "/tmp/anaquin_XXXXXX";
+    REQUIRE(mkdtemp(dir));
+    
+    bool spilled;
+    
+    {
+        MateStore s(budget, dir);
+        
+        VFlip::Mate x, y;
+        
+        Counts n = 0, h = 0;
+        
+        for (auto i = 0; i < 200; i++)
+        {
+            for (auto j = 0; j < (i % 5 ? 2 : 1); j++)
+            {
+                x.name        = "read" + std::to_string(i);
+                x.cID         = "chrev1";
+                x.seq         = std::string(50, 'A');
+                x.qual        = std::string(50, 'I');
+                x.flag        = j ? 147 : 99;
+                x.mapped      = true;
+                x.isForward   = !j;
+                x.isFirstPair = !j;
+                x.isReverse   = true;
+                
+                if (s.pair(x, y))
+                {
+                    REQUIRE(x.name == y.name);
+                    REQUIRE(y.flag == 99);
+                    n++;
+                }
+            }
+        }
+        
+        spilled = s.spilled();
+        
+        s.finish([&](VFlip::Mate &x, VFlip::Mate &y)
+        {
+            REQUIRE(x.name == y.name);
+            n++;
+        }, [&](VFlip::Mate &x)
+        {
+            REQUIRE(x.isFirstPair);
+            h++;
+        });
+        
+        REQUIRE(n == 160);
+        REQUIRE(h == 40);
+    }
+    
+    // Spilled partitions must have been removed
+    REQUIRE(!rmdir(dir));
+    
+    return spilled;
+}
+
+TEST_CASE("VFlip_MateStore")
+{
+    // Fits into memory
+    REQUIRE(!testMateStore(1 << 20));
+    
+    // Larger than the initial table (16KB), but not the mates
+    REQUIRE(testMateStore(1 << 15));
+}
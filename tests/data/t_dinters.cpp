@@ -223,3 +223,23 @@ TEST_CASE("Interval_Test_4")
     REQUIRE(!i.overlap(Locus(400,  450)));
     REQUIRE(!i.overlap(Locus(1000, 1000)));
 }
+
+TEST_CASE("Interval_Quantiles")
+{
+    DInter i("Gene A", Locus(1, 10));
+    
+    i.map(Locus(1, 10));
+    i.map(Locus(1, 5));
+    i.map(Locus(1, 2));
+    
+    // Coverage: 3 3 2 2 2 1 1 1 1 1
+    const auto s = i.stats();
+    
+    REQUIRE(s.length == 10);
+    REQUIRE(s.hist.size() == 10);
+    REQUIRE(s.p25 == Approx(1.0));
+    REQUIRE(s.p50 == Approx(1.5));
+    REQUIRE(s.p75 == Approx(2.0));
+    REQUIRE(s.min == 1);
+    REQUIRE(s.max == 3);
+}
@@ -67,4 +67,55 @@ TEST_CASE("ITree_1")
         auto v = t.findContained(85, 99);
         REQUIRE(v.size() == 0);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("FlatITree_Empty")
+{
+    FlatIntervalTree<int> t;
+    
+    std::vector<Interval_<int>> v;
+    t.findOverlapping(0, 1, v);
+    REQUIRE(v.empty());
+}
+
+TEST_CASE("FlatITree_1")
+{
+    std::vector<Interval_<Locus>> loci;
+    
+    // Nested and overlapping intervals, more than a single block
+    for (auto i = 0; i < 100; i++)
+    {
+        loci.push_back(locusToInterval(Locus(i * 10, i * 10 + (i % 3 ? 5 : 25))));
+    }
+    
+    loci.push_back(locusToInterval(Locus(0, 2000)));
+    
+    IntervalTree<Locus> t1 { loci };
+    FlatIntervalTree<Locus> t2(loci);
+    
+    REQUIRE(t2.size() == 101);
+    
+    for (auto i = 0; i < 1100; i += 7)
+    {
+        std::vector<Interval_<Locus>> v1, v2;
+        
+        REQUIRE(t1.findOverlapping(i, i + 12).size() == (t2.findOverlapping(i, i + 12, v1), v1.size()));
+        REQUIRE(t1.findContains(i, i + 3).size() == (t2.findContains(i, i + 3, v2), v2.size()));
+        
+        // Sorted by start
+        REQUIRE(std::is_sorted(v1.begin(), v1.end(), IntervalStartSorter<Locus>()));
+    }
+    
+    SECTION ("Early exit")
+    {
+        auto n = 0;
+        
+        t2.visitOverlapping(0, 100, [&](const Interval_<Locus> &)
+        {
+            n++;
+            return false;
+        });
+        
+        REQUIRE(n == 1);
+    }
+}
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <catch.hpp>
 #include "parsers/parser_bam.hpp"
 
@@ -68,6 +69,35 @@ TEST_CASE("Test_Deletion")
     REQUIRE(r3[1][1].end == 7058914);
 }
 
+TEST_CASE("Test_Workers")
+{
+    std::atomic<int> n(0);
+    std::atomic<int> w(0);
+
+    ParserBAM::parse("tests/data/deletion.sam", 4, [&](ParserBAM::Data &x, const ParserBAM::Info &i, unsigned k)
+    {
+        n++;
+        w = std::max(w.load(), (int) k);
+    });
+    
+    REQUIRE(n == 2);
+    REQUIRE(w < 4);
+}
+
+TEST_CASE("Test_FanOut")
+{
+    std::vector<Base> r1, r2;
+
+    ParserBAM::parse("tests/data/deletion.sam", std::vector<ParserBAM::Functor>
+    {
+        [&](ParserBAM::Data &x, const ParserBAM::Info &) { r1.push_back(x.l.start); },
+        [&](ParserBAM::Data &x, const ParserBAM::Info &) { r2.push_back(x.l.start); }
+    });
+    
+    REQUIRE(r1.size() == 2);
+    REQUIRE(r1 == r2);
+}
+
 TEST_CASE("Test_SoftClip")
 {
     std::vector<ParserBAM::Data> r1;
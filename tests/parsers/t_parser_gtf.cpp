@@ -1,4 +1,11 @@
+#include <zlib.h>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <unistd.h>
 #include <catch.hpp>
+#include <htslib/bgzf.h>
+#include "parsers/parser_gtf.hpp"
 #include "parsers/parser_gtf2.hpp"
 
 using namespace Anaquin;
@@ -40,13 +47,82 @@ TEST_CASE("ParserGTF_1")
     REQUIRE(t2d["R1_63_1"].fpkm == 1783.9793649586);
 }
 
+// Everything given by ParserGTF, one string per feature
+static std::vector<std::string> parseGTF(const Reader &r, unsigned threads)
+{
+    std::vector<std::string> x;
+
+    ParserGTF::parse(r, [&](const ParserGTF::Data &f, boost::string_ref line, const ParserProgress &p)
+    {
+        std::stringstream ss;
+        ss << p.i << " " << f.cID << " " << static_cast<int>(f.type) << " " << f.str << " " << f.l.start << " " << f.l.end << " "
+           << f.gID << " " << f.tID << " " << f.fpkm << " [" << line << "]";
+        x.push_back(ss.str());
+    }, threads);
+
+    return x;
+}
+
+TEST_CASE("ParserGTF_Compressed")
+{
+    std::ifstream r("tests/data/transcripts.gtf");
+    std::stringstream ss;
+    ss << r.rdbuf();
+
+    // Windows line endings, trailing spaces and blank lines must be the same for all inputs
+    std::string data;
+    std::string line;
+
+    for (auto i = 0; std::getline(ss, line); i++)
+    {
+        data += line + (i % 4 == 0 ? "\r\n" : i % 4 == 1 ? " \n" : i % 4 == 2 ? "\n\n" : "\n \r\n");
+    }
+
+    char tmp[] = "/tmp/anaquin_XXXXXX";
+    const std::string dir = mkdtemp(tmp);
+
+    const auto plain = dir + "/A.gtf";
+    const auto gzip  = dir + "/A.gtf.gz";
+    const auto bgzip = dir + "/A.bgzf.gtf.gz";
+
+    std::ofstream(plain) << data;
+
+    auto *gz = gzopen(gzip.c_str(), "wb");
+    REQUIRE(gz);
+    REQUIRE(gzwrite(gz, data.data(), data.size()) == data.size());
+    REQUIRE(gzclose(gz) == Z_OK);
+
+    auto *bgzf = bgzf_open(bgzip.c_str(), "w");
+    REQUIRE(bgzf);
+    REQUIRE(bgzf_write(bgzf, data.data(), data.size()) == data.size());
+    REQUIRE(!bgzf_close(bgzf));
+
+    const auto x = parseGTF(Reader(plain), 1);
+
+    REQUIRE(x.size() == 1365);
+    REQUIRE(x == parseGTF(Reader(data, DataMode::String), 1));
+
+    for (const auto &file : { plain, gzip, bgzip })
+    {
+        for (const auto threads : { 1u, 2u, 7u })
+        {
+            REQUIRE(x == parseGTF(Reader(file), threads));
+        }
+    }
+
+    REQUIRE(!std::remove(plain.c_str()));
+    REQUIRE(!std::remove(gzip.c_str()));
+    REQUIRE(!std::remove(bgzip.c_str()));
+    REQUIRE(!rmdir(dir.c_str()));
+}
+
 #ifdef INTERNAL_TESTING
 
 TEST_CASE("ParserGTF_Gencode")
 {
     std::vector<Feature> fs;
     
-    ParserGTF::parse(Reader("tests/data/GeneCodeV23Annotation.gtf"), [&](const ParserGTF::Data &f, const std::string &, const ParserProgress &)
+    ParserGTF::parse(Reader("tests/data/GeneCodeV23Annotation.gtf"), [&](const ParserGTF::Data &f, boost::string_ref, const ParserProgress &)
     {
         fs.push_back(f);
     });
@@ -0,0 +1,174 @@
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <catch.hpp>
+#include "tools/gtf_data.hpp"
+
+using namespace Anaquin;
+
+static std::string readAll(const FileName &file)
+{
+    std::ifstream r(file);
+    std::stringstream ss;
+    ss << r.rdbuf();
+    return ss.str();
+}
+
+static void writeAll(const FileName &file, const std::string &x)
+{
+    std::ofstream w(file);
+    w << x;
+}
+
+template <typename T> static void requireSame(const T &x, const T &y)
+{
+    REQUIRE(x.size() == y.size());
+
+    for (auto i = x.data().begin(), j = y.data().begin(); i != x.data().end(); i++, j++)
+    {
+        REQUIRE(i->first == j->first);
+        REQUIRE(i->second.l().start == j->second.l().start);
+        REQUIRE(i->second.l().end == j->second.l().end);
+    }
+}
+
+static void requireSame(const GTFData &x, const GTFData &y)
+{
+    REQUIRE(x.nGene() == y.nGene());
+    REQUIRE(x.countTrans() == y.countTrans());
+    REQUIRE(x.countUExon() == y.countUExon());
+    REQUIRE(x.countUIntr() == y.countUIntr());
+    REQUIRE(x.genes() == y.genes());
+
+    for (const auto &c : x)
+    {
+        const auto cID = x.str(c.cID);
+
+        // No interval without gene records
+        if (!x.genes(cID).empty())
+        {
+            requireSame(x.gIntervals(cID), y.gIntervals(cID));
+        }
+
+        requireSame(x.ueInters(cID),    y.ueInters(cID));
+        requireSame(x.uiInters(cID),    y.uiInters(cID));
+        requireSame(x.mergedExons(cID), y.mergedExons(cID));
+        requireSame(x.meInters(cID, Strand::Forward),  y.meInters(cID, Strand::Forward));
+        requireSame(x.meInters(cID, Strand::Backward), y.meInters(cID, Strand::Backward));
+    }
+}
+
+TEST_CASE("GTFData_Snapshot")
+{
+    char tmp[] = "/tmp/anaquin_XXXXXX";
+    const Path dir = mkdtemp(tmp);
+    const auto file = dir + "/A.gtf";
+
+    writeAll(file, readAll("tests/data/A1.gtf"));
+
+    // No cache directory, never snapshot
+    const auto x1 = GTFData::read(Reader(file));
+    const auto x2 = GTFData::read(Reader(file));
+
+    REQUIRE(!x1.mapped());
+    REQUIRE(!x2.mapped());
+    REQUIRE(access(GTFData::snapshot(file, dir).c_str(), F_OK));
+
+    // Build and write the snapshot
+    const auto b = GTFData::read(Reader(file), dir);
+
+    REQUIRE(!b.mapped());
+    REQUIRE(!access(GTFData::snapshot(file, dir).c_str(), F_OK));
+
+    // Memory-mapped from the snapshot
+    const auto m = GTFData::read(Reader(file), dir);
+
+    REQUIRE(m.mapped());
+    REQUIRE(b.countUExon() == 875);
+    requireSame(x1, b);
+    requireSame(b, m);
+
+    /*
+     * Rewrite the file with the same size and modification time, the snapshot must not be used
+     */
+
+    struct stat s;
+    REQUIRE(!stat(file.c_str(), &s));
+
+    auto x = readAll(file);
+    const auto i = x.find("2456935");
+    REQUIRE(i != std::string::npos);
+    x.replace(i, 7, "2456936");
+    writeAll(file, x);
+
+#ifdef __APPLE__
+    const struct timespec t[2] = { s.st_atimespec, s.st_mtimespec };
+#else
+    const struct timespec t[2] = { s.st_atim, s.st_mtim };
+#endif
+    REQUIRE(!utimensat(AT_FDCWD, file.c_str(), t, 0));
+
+    const auto c = GTFData::read(Reader(file), dir);
+
+    REQUIRE(!c.mapped());
+    requireSame(c, GTFData::read(Reader(file)));
+    REQUIRE(GTFData::read(Reader(file), dir).mapped());
+
+    REQUIRE(!std::remove(file.c_str()));
+    REQUIRE(!std::remove(GTFData::snapshot(file, dir).c_str()));
+    REQUIRE(!rmdir(dir.c_str()));
+}
+
+TEST_CASE("GTFData_SnapshotThreads")
+{
+    char tmp[] = "/tmp/anaquin_XXXXXX";
+    const Path dir = mkdtemp(tmp);
+    const auto file = dir + "/A.gtf";
+
+    writeAll(file, readAll("tests/data/A1.gtf"));
+
+    // Every thread parses and writes the snapshot at the same time
+    std::vector<GTFData> x(8);
+    std::vector<std::thread> ts;
+
+    for (auto i = 0; i < x.size(); i++)
+    {
+        ts.push_back(std::thread([&, i]() { x[i] = GTFData::read(Reader(file), dir); }));
+    }
+
+    for (auto &t : ts)
+    {
+        t.join();
+    }
+
+    // Nothing but the file and the snapshot (no temporary file left)
+    auto n = 0;
+    auto *d = opendir(dir.c_str());
+    REQUIRE(d);
+
+    while (auto *e = readdir(d))
+    {
+        n += e->d_name[0] != '.';
+    }
+
+    closedir(d);
+    REQUIRE(n == 2);
+
+    const auto m = GTFData::read(Reader(file), dir);
+
+    REQUIRE(m.mapped());
+
+    for (const auto &i : x)
+    {
+        requireSame(i, m);
+    }
+
+    REQUIRE(!std::remove(file.c_str()));
+    REQUIRE(!std::remove(GTFData::snapshot(file, dir).c_str()));
+    REQUIRE(!rmdir(dir.c_str()));
+}